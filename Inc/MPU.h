@@ -2,6 +2,7 @@
 #define MPU_H
 
 #include "stm32f1xx_hal.h"
+#include "fixmath.h"
 
 // ===== Initialization =====
 void MPU_Init(I2C_HandleTypeDef* hi2c);
@@ -11,10 +12,16 @@ void MPU_Init(I2C_HandleTypeDef* hi2c);
 void MPU_CalibrateGyroZ(void);
 
 // ===== Update & Read =====
-// Call periodically (e.g., every loop iteration)
+// Call periodically (e.g., every loop iteration). Queues a gyro read and returns;
+// the yaw is integrated when the read completes.
 void MPU_Update(void);
 
 // Returns yaw angle in degrees (-180 to +180)
 float MPU_GetYaw(void);
+real_t MPU_GetYawReal(void);   // Same, in the control math type
+
+// Gyro samples that hit the full-scale limit since power-up. If this grows
+// during turns, raise MPU_GYRO_FS_DPS or slow the turns down.
+uint32_t MPU_SaturatedSamples(void);
 
 #endif // MPU_H
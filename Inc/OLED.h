@@ -3,12 +3,18 @@
 #define OLED_H
 
 #include "stm32f1xx_hal.h"
+#include <stdbool.h>
 
 extern I2C_HandleTypeDef  *OLED_hi2c;
 
+// Clear/Print draw into a RAM framebuffer; nothing reaches the panel until OLED_Flush()
 void OLED_Init(void);
 void OLED_Clear(void);
 void OLED_Print(char *s, uint8_t col, uint8_t row);
 void OLED_PrintInt(int16_t val, uint8_t row, uint8_t col);
 
+// Queues the changed column range of each page, one transfer per page.
+// Returns false (and sends nothing) while the previous flush is still on the bus.
+bool OLED_Flush(void);
+
 #endif
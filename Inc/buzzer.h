@@ -2,11 +2,17 @@
 #define __BUZZER_H__
 
 #include "stm32f1xx_hal.h"
+#include <stdbool.h>
 
+// Tones are queued and played from the TIM1 update interrupt; every call returns at once
 void Buzzer_Init(TIM_HandleTypeDef *htim);
 void Buzzer_Tick(void);
 void Buzzer_Short(void);
 void Buzzer_Startup(void);
 void Buzzer_Confirm(void);
+bool Buzzer_Busy(void);         // Still playing queued tones
+
+// TIM1 update event
+void Buzzer_TimerTick(void);
 
 #endif
@@ -4,21 +4,47 @@
 #include "stm32f1xx_hal.h"  // or your specific HAL header
 
 /*=========================== Menu ===========================*/
-#define MAIN_MENU_COUNT    4
-#define ENCODER_STEP       50
+#define MAIN_MENU_COUNT    7
+#define ENCODER_STEP       200
 
 /*=========================== Motion =========================*/
 #define LOOP_DT_MS         1
-#define TICKS_PER_CELL     440
-#define TICK_FAST		   30
-#define TICKS_PER_TURN     125
+#define TICKS_PER_CELL     1760     // 4x quadrature ticks
+#define TICK_FAST		   120
+#define TICKS_PER_TURN     500
+#define CELL_MM            180.0f
+#define MM_PER_TICK        (CELL_MM / TICKS_PER_CELL)
 
-#define SPEED_MEDIUM       175
-#define SPEED_FAST         225
+/* Cruise speeds in mm/s */
+#define SPEED_MEDIUM       400.0f
+#define SPEED_FAST         550.0f
+#define TURN_BASE_SPEED    250.0f
+
+/* Motor PWM duty limits */
 #define SPEED_MIN         -255
 #define SPEED_MAX          255
 
-#define TURN_BASE_SPEED    150
+/* Forward velocity profile, in mm and mm/s */
+#define PROFILE_ACCEL      1600.0f  // mm/s^2
+#define PROFILE_DECEL      1200.0f  // mm/s^2
+#define PROFILE_JERK       25000.0f // mm/s^3, 0 for a trapezoidal profile
+#define PROFILE_V_CREEP    60.0f    // crawl speed to finish a segment ending at rest
+
+/* Wheels driven this long without turning count as a crash, which ends the run */
+#define MOTION_STALL_MS    400
+
+/* Continuous search: ticks before the cell centre at which the next cell's
+   walls are sampled and the following move is queued */
+#define SEARCH_DECIDE_TICKS 240
+
+/* Control math: 1 = Q16.16 fixed point (no FPU on the F103), 0 = float */
+#define USE_FIXED_POINT    1
+
+/*=========================== Planner ========================*/
+/* Relative time cost of each speed-run move (small integers) */
+#define PLAN_COST_STRAIGHT  2
+#define PLAN_COST_TURN90    3
+#define PLAN_COST_TURN180   5
 
 /*=========================== Buttons ========================*/
 #define BTN_CONFIRM_PORT   GPIOB
@@ -30,6 +56,10 @@
 #define BTN_RUN_PORT      GPIOA
 #define BTN_RUN_PIN       GPIO_PIN_6
 
+/*=========================== Display ========================*/
+#define DISPLAY_REFRESH_MS 200      // Minimum time between screen updates while moving
+#define DISPLAY_PAGE_MS    2000     // Multi-screen tables turn to the next screen this often
+
 /*=========================== Sensors ========================*/
 #define ADDR_LEFT          0x29
 #define ADDR_FRONT         0x31
@@ -44,7 +74,29 @@
 #define XSHUT_RIGHT_PORT   GPIOB
 #define XSHUT_RIGHT_PIN    GPIO_PIN_4
 
+#define TOF_PERIOD_MS      20       // Continuous ranging period, multiple of 10 ms
+
+#define MPU_USE_FIFO       1        // Drain every gyro sample from the MPU FIFO (0 = latest sample only)
+#define MPU_SAMPLE_RATE_HZ 1000     // Gyro sample rate, 1 kHz / (1 + SMPLRT_DIV) with the DLPF on
+#define MPU_DLPF_CFG       2        // Gyro bandwidth 98 Hz, 2.8 ms delay
+#define MPU_GYRO_FS_DPS    1000     // Gyro full scale: 250, 500, 1000 or 2000 °/s
+
 #define SENSOR_FRONT_LIMIT 150
 #define SENSOR_SIDE_LIMIT   45
 
+/*=========================== Parameters =====================*/
+/* Gains, speeds and calibration are run-time parameters (params.h); the
+   values in this file are their defaults. The linker script must leave
+   these pages out of its FLASH region. */
+#define PARAMS_FLASH_ADDR  0x0800F800  // Last two 1 KiB pages of the F103C8's 64 KiB
+#define PARAMS_FLASH_PAGES 2
+
+/*=========================== Telemetry ======================*/
+#define TELEMETRY_RECORDS  128      // Records kept for the post-run dump, power of two, 32 bytes each
+#define TELEMETRY_DECIMATE 8        // Control ticks per record: 128 records then span a whole move or turn
+#define TELEMETRY_BAUD     115200   // USART1 TX on PA9
+
+/*=========================== Profiling ======================*/
+#define PERF_ZONES         1        // Time hot paths on the DWT cycle counter (0 = compiled out)
+
 #endif // CONFIG_H
@@ -0,0 +1,18 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include "config.h"
+
+// Line console on the telemetry UART for the parameter table, one command per line:
+//     list                    every parameter and its value
+//     get NAME / set NAME V   V with up to three decimals; out-of-range values are clamped
+//     save / load / defaults  write to flash, revert to flash, revert to the built-in table
+//     perf                    the timing zones of the last run, in full
+// Bytes are collected by the RX interrupt; commands run in Console_Service().
+
+void Console_Init(UART_HandleTypeDef *huart);
+
+// Thread context, between runs: parameters must not change under a moving robot
+void Console_Service(void);
+
+#endif // CONSOLE_H
@@ -0,0 +1,20 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <stdint.h>
+
+// Run status for the OLED. Posting only records the latest values; the screen
+// is drawn and sent by Display_Service() while the robot is idle, or at most
+// every DISPLAY_REFRESH_MS while it moves.
+
+// action must be static text (a string literal); only the pointer is kept
+void Display_PostAction(const char *action);
+void Display_PostMove(int8_t fromX, int8_t fromY, int8_t toX, int8_t toY);
+// Replaces the status with the timing zone table and the gyro clipping count
+// until the next post, turning to the next screen every DISPLAY_PAGE_MS
+void Display_PostProfile(void);
+
+// Call from the main loop
+void Display_Service(void);
+
+#endif // DISPLAY_H
@@ -4,9 +4,12 @@
 #include "main.h"
 
 void ENCODER_Init(void);
-void ENCODER_ResetLeft(void);
-void ENCODER_ResetRight(void);
+
+// 4x quadrature counts. They are never reset: keep a previous reading and
+// take the difference (int32 subtraction stays correct across wrap-around).
 int32_t ENCODER_GetLeft(void);
 int32_t ENCODER_GetRight(void);
+// Both counts captured at the same instant
+void ENCODER_Read(int32_t *left, int32_t *right);
 
 #endif
@@ -0,0 +1,107 @@
+#ifndef FIXMATH_H
+#define FIXMATH_H
+
+#include <stdint.h>
+#include <math.h>
+#include "config.h"
+
+// Scalar type for the control paths. With USE_FIXED_POINT it is Q16.16
+// (range +-32767, resolution 1.5e-5), otherwise float for comparison.
+// Write control code against real_t and the r_ helpers only; plain + - and
+// comparisons, and division by an integer, work in both builds.
+
+#if USE_FIXED_POINT
+
+typedef int32_t real_t;
+
+#define REAL_ONE        65536
+// Compile-time constants only: the conversion folds away, at run time it is soft-float
+#define REAL(x)         ((real_t)((x) * 65536.0 + ((x) < 0 ? -0.5 : 0.5)))
+
+static inline real_t r_int(int32_t i)          { return (real_t)(i * REAL_ONE); }
+static inline real_t r_float(float f)          { return (real_t)(f * 65536.0f); }
+static inline int32_t r_toint(real_t a)        { return a / REAL_ONE; }
+static inline float r_tofloat(real_t a)        { return (float)a / 65536.0f; }
+static inline real_t r_mul(real_t a, real_t b) { return (real_t)(((int64_t)a * b) >> 16); }
+static inline real_t r_div(real_t a, real_t b) { return (real_t)((int64_t)a * REAL_ONE / b); }
+
+// a * b / c with a full-width intermediate, so a * b may exceed the Q16.16 range
+static inline real_t r_muldiv(real_t a, real_t b, real_t c) {
+    return (real_t)((int64_t)a * b / c);
+}
+
+// a * num / den for plain integers, e.g. per-second rates from microsecond spans
+static inline real_t r_scale(real_t a, int32_t num, int32_t den) {
+    return (real_t)((int64_t)a * num / den);
+}
+
+static inline uint32_t r_isqrt64(uint64_t v) {
+    uint64_t root = 0, bit = (uint64_t)1 << 62;
+    while (bit > v) bit >>= 2;
+    while (bit) {
+        if (v >= root + bit) {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+}
+
+// sqrt(a * b); the product is taken at full width (Q32.32) before the root
+static inline real_t r_sqrt_mul(real_t a, real_t b) {
+    int64_t p = (int64_t)a * b;
+    return (p > 0) ? (real_t)r_isqrt64((uint64_t)p) : 0;
+}
+
+#else
+
+typedef float real_t;
+
+#define REAL_ONE        1.0f
+#define REAL(x)         ((real_t)(x))
+
+static inline real_t r_int(int32_t i)          { return (real_t)i; }
+static inline real_t r_float(float f)          { return f; }
+static inline int32_t r_toint(real_t a)        { return (int32_t)a; }
+static inline float r_tofloat(real_t a)        { return a; }
+static inline real_t r_mul(real_t a, real_t b) { return a * b; }
+static inline real_t r_div(real_t a, real_t b) { return a / b; }
+static inline real_t r_muldiv(real_t a, real_t b, real_t c) { return a * b / c; }
+static inline real_t r_scale(real_t a, int32_t num, int32_t den) { return a * (float)num / (float)den; }
+
+static inline real_t r_sqrt_mul(real_t a, real_t b) {
+    real_t p = a * b;
+    return (p > 0.0f) ? sqrtf(p) : 0.0f;
+}
+
+#endif
+
+static inline real_t r_abs(real_t a)           { return (a < 0) ? -a : a; }
+static inline real_t r_min(real_t a, real_t b) { return (a < b) ? a : b; }
+static inline real_t r_max(real_t a, real_t b) { return (a > b) ? a : b; }
+
+static inline real_t r_clamp(real_t v, real_t lo, real_t hi) {
+    return (v < lo) ? lo : (v > hi) ? hi : v;
+}
+
+static inline real_t r_lpf(real_t previous, real_t current, real_t alpha) {
+    return previous + r_mul(alpha, current - previous);
+}
+
+// Sine of an angle in degrees, within 2e-4: a fifth-order series, folded into +-90
+static inline real_t r_sin_deg(real_t deg) {
+    while (deg >= REAL(180)) deg -= REAL(360);
+    while (deg < REAL(-180)) deg += REAL(360);
+    if (deg > REAL(90)) deg = REAL(180) - deg;
+    if (deg < REAL(-90)) deg = REAL(-180) - deg;
+    real_t x = r_mul(deg, REAL(0.017453293));
+    real_t x2 = r_mul(x, x);
+    return r_mul(x, REAL_ONE - r_mul(x2, REAL(1.0 / 6) - r_mul(x2, REAL(1.0 / 120))));
+}
+
+static inline real_t r_cos_deg(real_t deg) { return r_sin_deg(deg + REAL(90)); }
+
+#endif // FIXMATH_H
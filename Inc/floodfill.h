@@ -3,41 +3,38 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "maze.h"
 
-// Maze size
-#define W 16
-#define H 16
-
-// Directions
-typedef enum {
-    North = 0,
-    East,
-    South,
-    West
-} Direction;
-
-// Cell structure
-typedef struct {
-    bool walls[4];  // N, E, S, W
-    uint8_t dist;
-} Cell;
-
-// Pair for queue
+// Cell coordinate pair
 typedef struct {
     int8_t F, S;
 } Pair;
 
 // Public API
 void FloodFill_Init(void);
+// Starts from a known layout instead of an empty maze; the pose goes back to the start cell
+void FloodFill_LoadMaze(const MazeWalls *m);
+// Back on the start cell facing north for a speed run, with the walls learned so far
+void FloodFill_ResetPose(void);
 void FloodFill_SetGoal(int gx, int gy);
 void FloodFill_UpdateWalls(bool wallFront, bool wallRight, bool wallLeft);
 void FloodFill_Run(void);
+void FloodFill_Update(void);
 bool FloodFill_AtGoal(void);
+bool FloodFill_ExplorationDone(void);
+// Call with the walls of the current cell read: moves the search on from the
+// goal to exploring and then home, and is true once the robot is back at the
+// start cell, or when no route is left. Leaves dist[] ready for MoveStep
+bool FloodFill_SearchDone(void);
 void FloodFill_MoveStep(void);
+void FloodFill_GetBestPath(Direction path[], int *length);
+void FloodFill_GetFastestPath(Direction path[], int *length);
+void FloodFill_RunBestPath(bool diagonals);  // Queues the fastest known route, staircases cut into diagonals if asked
 
 // Accessors
 int8_t FloodFill_GetX(void);
 int8_t FloodFill_GetY(void);
 Direction FloodFill_GetDir(void);
+const MazeWalls *FloodFill_GetWalls(void);
 
 #endif // FLOODFILL_H
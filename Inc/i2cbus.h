@@ -0,0 +1,43 @@
+#ifndef I2CBUS_H
+#define I2CBUS_H
+
+#include "stm32f1xx_hal.h"
+#include <stdbool.h>
+
+// Interrupt-driven transaction queue for the shared I2C bus. Jobs wait in one
+// FIFO per priority and the highest non-empty one goes next, so a display
+// redraw never holds up a gyro read by more than the transfer in flight.
+
+typedef enum {
+    I2C_PRIO_GYRO,
+    I2C_PRIO_RANGE,
+    I2C_PRIO_DISPLAY,
+    I2C_PRIO_COUNT
+} I2CPriority;
+
+// Runs in interrupt context when the transfer finishes; keep it short.
+// It may queue follow-up jobs.
+typedef void (*I2CBus_Callback)(void *ctx, HAL_StatusTypeDef status);
+
+#define I2C_INLINE_MAX      8   // Writes up to this size are copied into the job
+#define I2C_DMA_MIN         16  // Writes from this size go by DMA when the handle has a TX channel
+#define I2C_QUEUE_LEN       16  // Jobs per priority, power of two
+
+void I2CBus_Init(I2C_HandleTypeDef *hi2c);
+
+// Queue a transfer to the 8-bit address addr. reg_size is 1 or 2 for a register
+// access, 0 for a plain transfer. Read buffers (and writes longer than
+// I2C_INLINE_MAX) must stay valid until done runs; done may be NULL.
+// Returns false if that priority's queue is full. Callable from interrupts.
+bool I2CBus_Read(I2CPriority prio, uint8_t addr, uint16_t reg, uint8_t reg_size,
+                 uint8_t *data, uint16_t len, I2CBus_Callback done, void *ctx);
+bool I2CBus_Write(I2CPriority prio, uint8_t addr, uint16_t reg, uint8_t reg_size,
+                  const uint8_t *data, uint16_t len, I2CBus_Callback done, void *ctx);
+
+// Blocking versions for setup code: queue, then wait for the result. Thread context only.
+HAL_StatusTypeDef I2CBus_ReadSync(I2CPriority prio, uint8_t addr, uint16_t reg, uint8_t reg_size,
+                                  uint8_t *data, uint16_t len);
+HAL_StatusTypeDef I2CBus_WriteSync(I2CPriority prio, uint8_t addr, uint16_t reg, uint8_t reg_size,
+                                   const uint8_t *data, uint16_t len);
+
+#endif // I2CBUS_H
@@ -3,6 +3,8 @@
 
 #include "stm32f1xx_hal.h"
 #include "config.h"
+#include "timebase.h"
+#include "i2cbus.h"
 #include "OLED.h"
 #include "encoder.h"
 #include "vl6180x.h"
@@ -10,11 +12,17 @@
 #include "buzzer.h"
 #include "MPU.h"
 #include "floodfill.h"
+#include "telemetry.h"
+#include "params.h"
+#include "console.h"
 
 /* Extern handles */
 extern I2C_HandleTypeDef hi2c1;
+extern DMA_HandleTypeDef hdma_i2c1_tx;
 extern TIM_HandleTypeDef htim1;
 extern TIM_HandleTypeDef htim2;
+extern TIM_HandleTypeDef htim3;
+extern UART_HandleTypeDef huart1;
 
 /* Extern devices */
 extern VL6180X tofLeft, tofFront, tofRight;
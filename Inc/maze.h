@@ -0,0 +1,42 @@
+#ifndef MAZE_H
+#define MAZE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Maze size (the bitboards below hold one row per uint16_t)
+#define W 16
+#define H 16
+
+// Directions
+typedef enum {
+    North = 0,
+    East,
+    South,
+    West
+} Direction;
+
+// Bit-packed wall map, one bitmask per row with bit x = column x.
+// Each wall is stored once, so both cells sharing it always agree.
+// The known masks tell "seen open" apart from "not yet seen".
+typedef struct {
+    uint16_t north[H];       // wall on the north side of (x, y)
+    uint16_t east[H];        // wall on the east side of (x, y)
+    uint16_t knownNorth[H];  // north side of (x, y) has been observed
+    uint16_t knownEast[H];   // east side of (x, y) has been observed
+} MazeWalls;
+
+// ===== Walls =====
+void Maze_Clear(MazeWalls *m);
+bool Maze_HasWall(const MazeWalls *m, int x, int y, Direction d);
+bool Maze_IsKnown(const MazeWalls *m, int x, int y, Direction d);
+// Marks the wall as observed; returns true if the stored wall actually changed
+bool Maze_SetWall(MazeWalls *m, int x, int y, Direction d, bool wall);
+
+// ===== Flood =====
+// Breadth-first distances from every cell set in seed[] (row masks).
+// Expands the wavefront a whole row at a time; unreachable cells get 255.
+// Unknown walls are open (optimistic) or closed (pessimistic) per unknownIsWall.
+void Maze_Flood(const MazeWalls *m, const uint16_t seed[H], bool unknownIsWall, uint8_t dist[W][H]);
+
+#endif // MAZE_H
@@ -3,6 +3,7 @@
 
 #include "config.h"
 #include "OLED.h"
+#include "params.h"
 #include <stdbool.h>
 
 /* Menu states */
@@ -11,12 +12,16 @@ typedef enum {
     MENU_SPEED, 
     MENU_TURN, 
     MENU_GOAL_X, 
-    MENU_GOAL_Y 
+    MENU_GOAL_Y,
+    MENU_SEARCH,
+    MENU_PARAM,         // subIndex picks the parameter
+    MENU_PARAM_EDIT     // The right wheel steps its value
 } MenuState;
 
 /* Globals that other files may use */
 extern int selectedSpeedIndex;
 extern int selectedTurnIndex;
+extern int selectedSearchIndex;   // 0 = stop in every cell, 1 = continuous
 extern int goalX, goalY;
 extern MenuState currentMenu;
 extern int mainIndex;
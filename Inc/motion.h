@@ -4,16 +4,58 @@
 #include "config.h"
 #include "init.h"
 
+/* Compiled motion primitives */
+typedef enum {
+    MOVE_STRAIGHT,
+    MOVE_TURN_LEFT,
+    MOVE_TURN_RIGHT,
+    MOVE_TURN_AROUND,
+    MOVE_DIAGONAL,
+    MOVE_TURN_L45,
+    MOVE_TURN_R45,
+    MOVE_TURN_L135,
+    MOVE_TURN_R135
+} MoveType;
+
+typedef struct {
+    uint8_t type;       // MoveType
+    uint8_t len;        // Half cells for MOVE_STRAIGHT, segments for MOVE_DIAGONAL
+} Move;
+
+/* How the 90 degree turns are driven; the menu's Turn page lists them in this order */
+typedef enum {
+    TURN_PIVOT,
+    TURN_CURVE,
+    TURN_DIAGONAL       // Curves, and a speed run also cuts staircases into diagonals
+} TurnMode;
+
 /* Motion helpers */
-void resetMotion(void);
-int  getBaseSpeed(void);
+void reset_motion(void);
 
-/* Movements */
+/* Control loop and command queue */
+void Motion_ControlTick(void);      // TIM3 update interrupt, every LOOP_DT_MS
+void Motion_Service(void);          // Thread context: refreshes sensors for the control tick
+void Motion_Enqueue(Move move);     // Returns immediately unless the queue is full
+bool Motion_Idle(void);
+bool Motion_ApproachingEnd(int ticks); // Idle, or the last queued straight is within ticks of its end
+void Motion_Wait(void);
+void Motion_SetTurnMode(TurnMode mode); // While stopped, before the run's first move
+void Motion_Abort(void);            // Drops the queue and brakes at once; the next move starts afresh
+bool Motion_Stalled(void);          // Driven into something; later moves are dropped until Motion_Abort()
+
+/* Blocking movements */
 void driveForward(int cells);
+void driveHalfCells(int half_cells);
+void driveDiagonal(int segments);
 void turn_pivot(float target_deg);
 void turn_curve(float target_deg);
-void turn_diagonal(void);
+void turn_diagonal(float target_deg);
 void turn90(bool left);
 void turn180(void);
 
+/* Path execution */
+int  compilePath(const Direction path[], int length, Direction startDir, Move moves[]);
+int  compileDiagonals(const Move in[], int count, Move out[]);
+void runMoves(const Move moves[], int count);
+
 #endif // MOTION_H
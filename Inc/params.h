@@ -0,0 +1,68 @@
+#ifndef PARAMS_H
+#define PARAMS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+#include "fixmath.h"
+
+// Tuning parameters, editable at run time from the menu or the serial console
+// and kept in the last PARAMS_FLASH_PAGES pages of flash. Values are stored
+// in thousandths, so neither side needs floating point; the control code
+// reads them through Params_Real(), a plain array load.
+typedef enum {
+    PARAM_KP_SIDE,          // Steering per mm of side difference (mm/s)
+    PARAM_KD_SIDE,          // Steering per mm of side difference change per TOF_PERIOD_MS (mm/s)
+    PARAM_KENC,             // Steering per tick of encoder imbalance (mm/s)
+    PARAM_KP_DIAG_YAW,      // Diagonal heading hold steering per degree (mm/s)
+    PARAM_KP_YAW,           // Curve inner wheel slowdown per degree of yaw error (mm/s)
+    PARAM_KP_PIVOT,         // Pivot wheel speed per degree of yaw error (mm/s)
+    PARAM_CURVE_SPEED,      // Outer wheel speed during curves (mm/s)
+    PARAM_PIVOT_SPEED,      // Fastest pivot wheel speed (mm/s)
+    PARAM_KS_WHEEL,         // Feedforward PWM to overcome static friction
+    PARAM_KV_WHEEL,         // Feedforward PWM per mm/s
+    PARAM_KA_WHEEL,         // Feedforward PWM per mm/s^2
+    PARAM_KP_WHEEL,         // PWM per mm/s of speed error
+    PARAM_KI_WHEEL,         // PWM per mm of accumulated speed error
+    PARAM_KD_WHEEL,         // PWM per mm/s^2 of speed error change
+    PARAM_SPEED_MEDIUM,     // Cruise speeds (mm/s) for the menu's speed choices
+    PARAM_SPEED_FAST,
+    PARAM_ACCEL,            // Forward profile (mm/s^2)
+    PARAM_DECEL,
+    PARAM_TICKS_PER_CELL,   // Encoder calibration, 4x quadrature ticks
+    PARAM_TICKS_PER_TURN,
+    PARAM_FRONT_LIMIT,      // Walls: farthest reading that counts as one (mm)
+    PARAM_SIDE_LIMIT,       // Start gesture: hand closer than this over both sides (mm)
+    PARAM_COUNT
+} ParamId;
+
+// Bump when the table above changes; records of another version are ignored
+#define PARAMS_VERSION      1
+
+extern real_t params_real[PARAM_COUNT];
+
+// Loads the newest valid record from flash, or the defaults
+void Params_Init(void);
+
+static inline real_t Params_Real(ParamId id) { return params_real[id]; }
+int32_t Params_Int(ParamId id);             // Rounded to a whole number
+int32_t Params_Get(ParamId id);             // Thousandths
+bool Params_Set(ParamId id, int32_t milli); // False when out of range
+int32_t Params_Step(ParamId id);            // Menu increment, thousandths
+
+const char *Params_Name(ParamId id);
+int Params_Find(const char *name);          // -1 when unknown
+// Value in thousandths as a decimal without trailing zeros; returns the snprintf length
+int Params_Format(int32_t milli, char *buf, size_t size);
+bool Params_Parse(const char *text, int32_t *milli);
+
+// Changed since the last load or save
+bool Params_Dirty(void);
+void Params_Defaults(void);
+bool Params_Load(void);                     // False when flash holds no valid record
+// Appends a record to the next free flash slot; blocks for a page erase now and
+// then, so call it only while the robot stands still. False on a flash error
+bool Params_Save(void);
+
+#endif // PARAMS_H
@@ -0,0 +1,54 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+#include "timebase.h"
+
+// Named timing zones over the DWT cycle counter. Bracket a hot path with
+//     uint32_t t0 = Perf_Begin();  ...  Perf_End(PERF_X, t0);
+// Each zone keeps count, min, max and total; zones may nest and may be
+// ended from interrupts. With PERF_ZONES 0 everything compiles away.
+typedef enum {
+    PERF_FLOOD_RUN,         // Full flood of a distance field, FloodFill_Run() or a repair's fallback
+    PERF_FLOOD_UPDATE,      // FloodFill_Update(): incremental repair
+    PERF_TOF_READ,          // VL6180X_ReadRange()
+    PERF_MOTION_SERVICE,    // Motion_Service(): one sensor snapshot
+    PERF_CONTROL_TICK,      // Motion_ControlTick(): one control period
+    PERF_OLED_PRINT,        // OLED_Print()
+    PERF_OLED_FLUSH,        // OLED_Flush()
+    PERF_ZONE_COUNT
+} PerfZone;
+
+typedef struct {
+    uint32_t count;
+    uint32_t min, max;      // Ticks
+    uint64_t total;
+} PerfStats;
+
+#define PERF_TICKS_PER_US   (SystemCoreClock / 1000000u)
+static inline uint32_t perf_now(void) { return Timebase_Cycles(); }
+
+#if PERF_ZONES
+static inline uint32_t Perf_Begin(void) { return perf_now(); }
+void Perf_End(PerfZone zone, uint32_t start);
+#else
+static inline uint32_t Perf_Begin(void) { return 0; }
+static inline void Perf_End(PerfZone zone, uint32_t start) { (void)zone; (void)start; }
+#endif
+
+void Perf_Reset(void);
+// Consistent copy of one zone's statistics
+void Perf_Get(PerfZone zone, PerfStats *out);
+const char *Perf_Name(PerfZone zone);
+
+// "name count min mean max" with times in µs to 0.1 µs; returns the snprintf length
+int Perf_Format(PerfZone zone, char *buf, size_t size);
+// The 128x32 panel holds a header and PERF_DRAW_ZONES zones, so the table takes PERF_DRAW_PAGES screens
+#define PERF_DRAW_ZONES     3
+#define PERF_DRAW_PAGES     ((PERF_ZONE_COUNT + PERF_DRAW_ZONES - 1) / PERF_DRAW_ZONES)
+// One screen of the zone table on the OLED framebuffer (min/mean/max in whole µs); the caller flushes
+void Perf_Draw(int page);
+
+#endif // PERF_H
@@ -0,0 +1,24 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+#include "fixmath.h"
+
+// Online jerk-limited velocity profile for a single forward segment.
+// Distances and speeds are in whatever units the caller uses (mm and mm/s
+// for motion.c). jerk = 0 gives a plain trapezoid.
+typedef struct {
+    real_t distance;    // segment length
+    real_t v_max;       // cruise speed, may be lowered mid-segment
+    real_t v_end;       // speed to carry into the next segment
+    real_t accel, decel, jerk;
+    real_t vel;         // current target speed
+    real_t acc;         // current target acceleration
+} Profile;
+
+void Profile_Start(Profile *p, real_t distance, real_t v_start, real_t v_max, real_t v_end);
+// Advances one control period (1 / rate_hz s) given the distance actually travelled;
+// returns the target speed
+real_t Profile_Step(Profile *p, real_t travelled, int rate_hz);
+
+#endif // PROFILE_H
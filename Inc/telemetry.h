@@ -0,0 +1,53 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "config.h"
+
+// Ring of the last TELEMETRY_RECORDS records, one every TELEMETRY_DECIMATE control
+// ticks, filled by the control loop while a run is recorded and sent over the
+// serial port when it ends, including an abort or a crash.
+// Fixed-point fields keep a record at 32 bytes; sim/tlm2csv turns a dump into CSV.
+
+#define TELEMETRY_IDLE      0x0F    // state: no command running
+#define TELEMETRY_BRAKED    0x80    // state: motors shorted, pwm fields not driven
+
+typedef struct {
+    uint32_t t_us;                      // Timebase_Us() of the tick's encoder reading
+    int16_t enc_left, enc_right;        // Low 16 bits of the free-running counts
+    uint8_t tof_left, tof_front, tof_right; // Raw ranges the tick used, mm
+    uint8_t state;                      // Command type or TELEMETRY_IDLE, | TELEMETRY_BRAKED
+    int16_t left_filtered, right_filtered;  // Side wall filter, mm * 16
+    int16_t yaw;                        // deg * 100
+    int16_t error;                      // Straight: centering error, mm * 16; otherwise yaw error, deg * 100
+    int16_t target_left, target_right;  // Wheel speed targets, mm/s
+    int16_t speed_left, speed_right;    // Measured wheel speeds, mm/s
+    int16_t pwm_left, pwm_right;        // Motor commands, SPEED_MIN..SPEED_MAX
+} TelemetryRecord;
+
+_Static_assert(sizeof(TelemetryRecord) == 32, "telemetry record layout changed; update tlm2csv");
+
+// Dump framing, all little-endian: header, count records oldest first,
+// then the Fletcher-16 of the record bytes
+#define TELEMETRY_MAGIC     0x314D4C54u     // "TLM1"
+
+typedef struct {
+    uint32_t magic;
+    uint16_t count;
+    uint16_t record_size;
+} TelemetryHeader;
+
+void Telemetry_Init(UART_HandleTypeDef *huart);
+
+// Clears the ring and starts recording
+void Telemetry_Start(void);
+void Telemetry_Stop(void);
+
+// Control tick: the slot to fill for this tick, or NULL while not recording or between records
+TelemetryRecord *Telemetry_Slot(void);
+
+// Blocking send of the recorded ticks; call after Telemetry_Stop()
+void Telemetry_Dump(void);
+
+#endif // TELEMETRY_H
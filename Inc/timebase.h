@@ -0,0 +1,19 @@
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include "stm32f1xx_hal.h"
+
+// Free-running microsecond clock from the DWT cycle counter. The 32-bit value
+// wraps after ~71 minutes: compare timestamps by subtraction only. It must be
+// read at least every ~59 s (one CYCCNT wrap at 72 MHz); the control tick does.
+void Timebase_Init(void);
+uint32_t Timebase_Us(void);
+static inline uint32_t Timebase_Cycles(void) { return DWT->CYCCNT; }
+
+// Microseconds since an earlier Timebase_Us() reading
+static inline uint32_t Timebase_Since(uint32_t start_us) { return Timebase_Us() - start_us; }
+
+// Busy-wait; for short hardware delays only
+void Timebase_DelayUs(uint32_t us);
+
+#endif // TIMEBASE_H
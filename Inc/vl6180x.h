@@ -2,6 +2,7 @@
 #define VL6180X_H
 
 #include "stm32f1xx_hal.h" // Change if you're using a different STM32 family
+#include <stdbool.h>
 
 #define VL6180X_DEFAULT_I2C_ADDR 0x29 << 1  // STM32 HAL uses 8-bit addressing
 
@@ -9,6 +10,15 @@ typedef struct {
     I2C_HandleTypeDef *hi2c;
     uint8_t address;
     float smoothedRange;  // <-- NEW: filtered range value
+
+    // Continuous ranging state
+    bool continuous;
+    uint8_t period_ms;    // Inter-measurement period
+    volatile uint8_t range;        // Latest result (mm)
+    volatile uint8_t samples;      // Incremented for every new result
+    volatile uint32_t sample_us;   // Timebase_Us() when the latest result was read
+    volatile bool busy;            // Poll transfers queued on the bus
+    uint8_t rx;                    // Receive buffer for the poll transfers
 } VL6180X;
 
 
@@ -19,4 +29,13 @@ uint8_t VL6180X_ReadRegister(VL6180X *dev, uint16_t reg);
 HAL_StatusTypeDef VL6180X_WriteRegister(VL6180X *dev, uint16_t reg, uint8_t value);
 void VL6180X_SetI2CAddress(VL6180X *dev, uint8_t new_address);
 
+// ===== Continuous ranging =====
+// The sensor ranges on its own every period_ms (multiple of 10); VL6180X_Poll()
+// queues a non-blocking status check and fetches a result only once one is ready.
+// New results land in range/samples from the I2C interrupt.
+// In this mode VL6180X_ReadRange() returns the latest result without waiting.
+void VL6180X_StartContinuous(VL6180X *dev, uint8_t period_ms);
+void VL6180X_StopContinuous(VL6180X *dev);
+void VL6180X_Poll(VL6180X *dev);
+
 #endif
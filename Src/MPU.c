@@ -1,4 +1,6 @@
 #include "MPU.h"
+#include "i2cbus.h"
+#include "timebase.h"
 #include <math.h>
 
 #define MPU_ADDR (0x68 << 1)
@@ -7,24 +9,56 @@
 #define PWR_MGMT_1 0x6B
 #define ACCEL_XOUT_H 0x3B
 #define GYRO_XOUT_H  0x43
+#define SMPLRT_DIV   0x19
+#define CONFIG       0x1A
+#define FIFO_EN      0x23
+#define USER_CTRL    0x6A
+#define FIFO_COUNT_H 0x72
+#define FIFO_R_W     0x74
+
+#define FIFO_EN_ZG       0x10   // FIFO_EN: queue gyro Z samples
+#define USER_FIFO_EN     0x40
+#define USER_FIFO_RESET  0x04
+#define FIFO_SIZE        1024   // Bytes
+#define FIFO_BURST       16     // Max samples drained per read
 
 I2C_HandleTypeDef* MPU_hi2c;
 
-static float GYRO_SENS_DPS = 32.8f;   // ±1000 dps -> 32.8 LSB per °/s
+// GYRO_CONFIG FS_SEL for the configured full-scale range
+#if   MPU_GYRO_FS_DPS == 250
+#define GYRO_FS_SEL 0x00
+#elif MPU_GYRO_FS_DPS == 500
+#define GYRO_FS_SEL 0x08
+#elif MPU_GYRO_FS_DPS == 1000
+#define GYRO_FS_SEL 0x10
+#elif MPU_GYRO_FS_DPS == 2000
+#define GYRO_FS_SEL 0x18
+#else
+#error "MPU_GYRO_FS_DPS must be 250, 500, 1000 or 2000"
+#endif
 
-static float angle_z;
-static float gyro_z;
-static float gyro_z_offset = 0;
+// Full scale maps to the int16 range: 131 LSB per °/s at ±250, 32.8 at ±1000, ...
+static const real_t GYRO_SENS_DPS = REAL(32768.0 / MPU_GYRO_FS_DPS);
+#define GYRO_SATURATED 32700    // Raw magnitude treated as clipped
 
-static uint32_t last_time = 0;
-static float dt;
+static volatile uint32_t saturated_samples;
+
+static real_t angle_z;
+static real_t gyro_z;
+static real_t gyro_z_offset = 0;     // °/s, so a full-scale raw sample never has to fit in real_t beside it
+
+static uint32_t last_time = 0;        // Timebase_Us() of the previous sample
 
 static int16_t gz;
 
+static uint8_t gyro_data[FIFO_BURST * 2];   // Async read buffer
+static uint8_t fifo_count[2];
+static volatile bool gyro_pending;
+
 // ===== Internal: Read raw gyro Z only =====
 static void Read_MPU_GyroZ() {
     uint8_t data[2];
-    HAL_I2C_Mem_Read(MPU_hi2c, MPU_ADDR, GYRO_XOUT_H + 4, 1, data, 2, 10);
+    I2CBus_ReadSync(I2C_PRIO_GYRO, MPU_ADDR, GYRO_XOUT_H + 4, 1, data, 2);
     gz = (int16_t)(data[0] << 8 | data[1]);
 }
 
@@ -32,21 +66,33 @@ static void Read_MPU_GyroZ() {
 void MPU_Init(I2C_HandleTypeDef* hi2c) {
     MPU_hi2c = hi2c;
 
-    uint8_t check;
-    HAL_I2C_Mem_Read(MPU_hi2c, MPU_ADDR, 0x75, 1, &check, 1, 10);
+    uint8_t check = 0;
+    I2CBus_ReadSync(I2C_PRIO_GYRO, MPU_ADDR, 0x75, 1, &check, 1);
     if (check != 0x68) return; // Not detected
 
     uint8_t data;
 
-    data = 0x00;
-    HAL_I2C_Mem_Write(MPU_hi2c, MPU_ADDR, PWR_MGMT_1, 1, &data, 1, 10);
+    data = 0x01;    // Clock from the gyro PLL: steadier sample period than the internal oscillator
+    I2CBus_WriteSync(I2C_PRIO_GYRO, MPU_ADDR, PWR_MGMT_1, 1, &data, 1);
 
-    data = 0x00;
-    HAL_I2C_Mem_Write(MPU_hi2c, MPU_ADDR, ACCEL_CONFIG, 1, &data, 1, 10);  // ±2g
-    data = 0x00;
-    HAL_I2C_Mem_Write(MPU_hi2c, MPU_ADDR, GYRO_CONFIG, 1, &data, 1, 10);   // ±250°/s
+    data = MPU_DLPF_CFG;
+    I2CBus_WriteSync(I2C_PRIO_GYRO, MPU_ADDR, CONFIG, 1, &data, 1);
+    data = 1000 / MPU_SAMPLE_RATE_HZ - 1;
+    I2CBus_WriteSync(I2C_PRIO_GYRO, MPU_ADDR, SMPLRT_DIV, 1, &data, 1);
 
-    last_time = HAL_GetTick();
+    data = 0x00;
+    I2CBus_WriteSync(I2C_PRIO_GYRO, MPU_ADDR, ACCEL_CONFIG, 1, &data, 1);  // ±2g
+    data = GYRO_FS_SEL;
+    I2CBus_WriteSync(I2C_PRIO_GYRO, MPU_ADDR, GYRO_CONFIG, 1, &data, 1);   // ±MPU_GYRO_FS_DPS °/s
+
+#if MPU_USE_FIFO
+    data = FIFO_EN_ZG;
+    I2CBus_WriteSync(I2C_PRIO_GYRO, MPU_ADDR, FIFO_EN, 1, &data, 1);
+    data = USER_FIFO_EN | USER_FIFO_RESET;
+    I2CBus_WriteSync(I2C_PRIO_GYRO, MPU_ADDR, USER_CTRL, 1, &data, 1);
+#endif
+
+    last_time = Timebase_Us();
 }
 
 // ===== Calibrate Gyro Z Drift =====
@@ -60,27 +106,114 @@ void MPU_CalibrateGyroZ() {
         HAL_Delay(2);
     }
 
-    gyro_z_offset = (float)sum_gz / samples;
+    gyro_z_offset = r_div(r_float((float)sum_gz / samples), GYRO_SENS_DPS);
+
+#if MPU_USE_FIFO
+    // The FIFO overflowed while we sampled; start integrating from fresh data
+    uint8_t data = USER_FIFO_EN | USER_FIFO_RESET;
+    I2CBus_WriteSync(I2C_PRIO_GYRO, MPU_ADDR, USER_CTRL, 1, &data, 1);
+#endif
+    last_time = Timebase_Us();
+}
+
+// Raw sample to °/s with offset correction. A clipped sample still counts at
+// full scale, but the true rate was higher and the yaw will come out short.
+static real_t gyro_rate(int16_t raw) {
+    if (raw >= GYRO_SATURATED || raw <= -GYRO_SATURATED) saturated_samples++;
+    return r_div(r_int(raw), GYRO_SENS_DPS) - gyro_z_offset;
+}
+
+static void wrap_yaw(void) {
+    if (angle_z > REAL(180)) angle_z -= REAL(360);
+    else if (angle_z < REAL(-180)) angle_z += REAL(360);
 }
 
 // ===== Update Yaw =====
+#if MPU_USE_FIFO
+// FIFO mode: every sample is integrated over the sensor's own sample period,
+// so the result no longer depends on when (or how often) MPU_Update() runs.
+static void fifo_data_done(void *ctx, HAL_StatusTypeDef status) {
+    int n = (int)(uintptr_t)ctx;
+    gyro_pending = false;
+    if (status != HAL_OK) return;
+
+    real_t rate_sum = 0;
+    for (int i = 0; i < n; i++) {
+        gz = (int16_t)(gyro_data[2 * i] << 8 | gyro_data[2 * i + 1]);
+        gyro_z = gyro_rate(gz);
+        rate_sum += gyro_z;
+    }
+
+    // Sum of rates * (1 / sample rate)
+    angle_z += r_muldiv(rate_sum, REAL_ONE, r_int(MPU_SAMPLE_RATE_HZ));
+    wrap_yaw();
+}
+
+static void fifo_count_done(void *ctx, HAL_StatusTypeDef status) {
+    static const uint8_t reset = USER_FIFO_EN | USER_FIFO_RESET;
+    (void)ctx;
+
+    uint16_t count = (uint16_t)(fifo_count[0] << 8 | fifo_count[1]);
+    if (status != HAL_OK || count < 2) {
+        gyro_pending = false;
+        return;
+    }
+
+    // Overflowed (samples lost) or out of step with the 2-byte samples: start over
+    if (count >= FIFO_SIZE - 2 || (count & 1)) {
+        I2CBus_Write(I2C_PRIO_GYRO, MPU_ADDR, USER_CTRL, 1, &reset, 1, NULL, NULL);
+        gyro_pending = false;
+        return;
+    }
+
+    uint16_t n = count / 2;
+    if (n > FIFO_BURST) n = FIFO_BURST;   // The rest goes on the next call
+    if (!I2CBus_Read(I2C_PRIO_GYRO, MPU_ADDR, FIFO_R_W, 1, gyro_data, n * 2, fifo_data_done, (void *)(uintptr_t)n))
+        gyro_pending = false;
+}
+
 void MPU_Update() {
-    uint32_t now = HAL_GetTick();
-    dt = (now - last_time) / 1000.0f;
+    if (gyro_pending) return;   // Previous read still on the bus
+
+    gyro_pending = true;
+    if (!I2CBus_Read(I2C_PRIO_GYRO, MPU_ADDR, FIFO_COUNT_H, 1, fifo_count, 2, fifo_count_done, NULL))
+        gyro_pending = false;
+}
+
+#else
+// Runs from the I2C interrupt once the queued gyro read completes
+static void gyro_read_done(void *ctx, HAL_StatusTypeDef status) {
+    (void)ctx;
+    gyro_pending = false;
+    if (status != HAL_OK) return;
+
+    uint32_t now = Timebase_Us();
+    int32_t dt_us = (int32_t)(now - last_time);
     last_time = now;
 
-    Read_MPU_GyroZ();
+    gz = (int16_t)(gyro_data[0] << 8 | gyro_data[1]);
 
     // Gyroscope rate (deg/sec) with offset correction
-    gyro_z = (gz - gyro_z_offset) / 131.0f;
+    gyro_z = gyro_rate(gz);
 
-    // Integrate yaw
-    angle_z += gyro_z * dt;
+    // Integrate yaw over the real time between reads (full width, dt_us can be large after a pause)
+    angle_z += r_scale(gyro_z, dt_us, 1000000);
 
     // Wrap to -180..180
-    if (angle_z > 180.0f) angle_z -= 360.0f;
-    else if (angle_z < -180.0f) angle_z += 360.0f;
+    wrap_yaw();
+}
+
+void MPU_Update() {
+    if (gyro_pending) return;   // Previous read still on the bus
+
+    gyro_pending = true;
+    if (!I2CBus_Read(I2C_PRIO_GYRO, MPU_ADDR, GYRO_XOUT_H + 4, 1, gyro_data, 2, gyro_read_done, NULL))
+        gyro_pending = false;
 }
+#endif
 
 // ===== Get Yaw =====
-float MPU_GetYaw() { return angle_z; }
+float MPU_GetYaw() { return r_tofloat(angle_z); }
+real_t MPU_GetYawReal() { return angle_z; }
+
+uint32_t MPU_SaturatedSamples() { return saturated_samples; }
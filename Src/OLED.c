@@ -1,4 +1,6 @@
 #include "OLED.h"
+#include "i2cbus.h"
+#include "perf.h"
 #include <stdio.h>
 
 I2C_HandleTypeDef *OLED_hi2c;
@@ -116,46 +118,56 @@ static const uint8_t Oled_InitCommand[] = {
 		0xAF        // Display ON
 };
 
+#define OLED_WIDTH  128
+#define OLED_PAGES  4   // 128x32: four 8-pixel pages
+
+// Drawing only touches RAM; OLED_Flush() sends the changed column range of each page
+static uint8_t framebuffer[OLED_PAGES][OLED_WIDTH];
+static uint8_t dirty_lo[OLED_PAGES], dirty_hi[OLED_PAGES];  // lo > hi: page is clean
+static volatile uint8_t flush_pending;                       // Page transfers still on the bus
+
+static void put_column(uint8_t page, uint8_t col, uint8_t bits) {
+	if (framebuffer[page][col] == bits) return;
+	framebuffer[page][col] = bits;
+	if (dirty_lo[page] > dirty_hi[page]) {
+		dirty_lo[page] = dirty_hi[page] = col;
+	} else {
+		if (col < dirty_lo[page]) dirty_lo[page] = col;
+		if (col > dirty_hi[page]) dirty_hi[page] = col;
+	}
+}
+
 void OLED_Init(void){
-	HAL_I2C_Master_Transmit(OLED_hi2c, DevAdd, (uint8_t *)Oled_InitCommand, sizeof(Oled_InitCommand), 500);
+	I2CBus_WriteSync(I2C_PRIO_DISPLAY, DevAdd, 0, 0, Oled_InitCommand, sizeof(Oled_InitCommand));
 	HAL_Delay(1);
+
+	// Panel RAM is random at power-up: send the whole (blank) framebuffer on the first flush
+	for (uint8_t page = 0; page < OLED_PAGES; page++) {
+		dirty_lo[page] = 0;
+		dirty_hi[page] = OLED_WIDTH - 1;
+	}
 }
 
 void OLED_Clear(void) {
-    for (uint8_t page = 0; page < 4; page++) { // Với màn hình 128x32 thì có 4 page
-        uint8_t cmd[] = {0x00, (uint8_t)(0xB0 + page), 0x00, 0x10};
-        HAL_I2C_Master_Transmit(OLED_hi2c, DevAdd, cmd, sizeof(cmd), 500);
-
-        uint8_t data[129]; // 1 byte control + 128 byte data
-        data[0] = 0x40; // control byte cho dữ liệu
-        for (int i = 1; i < 129; i++) data[i] = 0x00;
-
-        HAL_I2C_Master_Transmit(OLED_hi2c, DevAdd, data, sizeof(data), 500);
-    }
+	for (uint8_t page = 0; page < OLED_PAGES; page++)
+		for (uint8_t col = 0; col < OLED_WIDTH; col++)
+			put_column(page, col, 0x00);
 }
 
-
 void OLED_Print(char *s, uint8_t row, uint8_t col) {
-	uint8_t page[] = { 0x00, (uint8_t)(0xB0 + row), (uint8_t)(0x00 | (col & 0x0F)), (uint8_t)(0x10 | (col >> 4))};
-	HAL_I2C_Master_Transmit(OLED_hi2c, DevAdd, (uint8_t *)page, sizeof(page), 500);
-
-	while (*s) {
-		uint8_t bytes[7];
-		for (int i = 0; i < 5; i++) {
-			   bytes[i+1] = font5x7[*s - 32][i];
-		}
-		bytes[0] = 0x40;
-		bytes[6] = 0x00;
-		HAL_I2C_Master_Transmit(OLED_hi2c, DevAdd, bytes, sizeof(bytes), 500);
+	if (row >= OLED_PAGES) return;
+	uint32_t t0 = Perf_Begin();
+
+	while (*s && col < OLED_WIDTH) {
+		char c = (*s < ' ' || *s > '~') ? '?' : *s;
+		for (int i = 0; i < 5 && col < OLED_WIDTH; i++) put_column(row, col++, font5x7[c - 32][i]);
+		if (col < OLED_WIDTH) put_column(row, col++, 0x00);
 		s++;
-		col+=6;
 	}
-	uint8_t Clrscr[] = { 0x00, (uint8_t)(0xB0 + row), (uint8_t)(0x00 | (col & 0x0F)), (uint8_t)(0x10 | (col >> 4))};
-	HAL_I2C_Master_Transmit(OLED_hi2c, DevAdd, (uint8_t *)Clrscr, sizeof(Clrscr), 500);
-	uint8_t ClrByte[] = {0x40, 0x00};
-	for (int i = col; i < 128; i++) {
-			HAL_I2C_Master_Transmit(OLED_hi2c, DevAdd, (uint8_t *)ClrByte, sizeof(ClrByte), 500);
-		}
+
+	// Blank the rest of the row
+	while (col < OLED_WIDTH) put_column(row, col++, 0x00);
+	Perf_End(PERF_OLED_PRINT, t0);
 }
 
 void OLED_PrintInt(int16_t val, uint8_t row, uint8_t col) {
@@ -163,3 +175,35 @@ void OLED_PrintInt(int16_t val, uint8_t row, uint8_t col) {
     sprintf(buf, "%d", val); // Supports negatives, any number of digits up to 32-bit
     OLED_Print(buf, row, col);
 }
+
+static void flush_done(void *ctx, HAL_StatusTypeDef status) {
+	(void)ctx; (void)status;
+	flush_pending--;
+}
+
+bool OLED_Flush(void) {
+	if (flush_pending) return false;
+	uint32_t t0 = Perf_Begin();
+
+	uint8_t lo[OLED_PAGES], hi[OLED_PAGES], count = 0;
+	for (uint8_t page = 0; page < OLED_PAGES; page++) {
+		lo[page] = dirty_lo[page];
+		hi[page] = dirty_hi[page];
+		if (lo[page] <= hi[page]) count++;
+		dirty_lo[page] = OLED_WIDTH - 1;    // Clean until drawn on again
+		dirty_hi[page] = 0;
+	}
+	flush_pending = count;  // Set before any transfer can complete
+
+	for (uint8_t page = 0; page < OLED_PAGES; page++) {
+		if (lo[page] > hi[page]) continue;
+
+		// Page/column address (control byte 0x00), then the run straight from the framebuffer
+		// (control byte 0x40); the bus reads it in the background, with DMA for long runs
+		uint8_t cmd[] = { (uint8_t)(0xB0 + page), (uint8_t)(0x00 | (lo[page] & 0x0F)), (uint8_t)(0x10 | (lo[page] >> 4)) };
+		while (!I2CBus_Write(I2C_PRIO_DISPLAY, DevAdd, 0x00, 1, cmd, sizeof(cmd), NULL, NULL)) {}
+		while (!I2CBus_Write(I2C_PRIO_DISPLAY, DevAdd, 0x40, 1, &framebuffer[page][lo[page]], (uint16_t)(hi[page] - lo[page] + 1), flush_done, NULL)) {}
+	}
+	Perf_End(PERF_OLED_FLUSH, t0);
+	return true;
+}
@@ -3,34 +3,85 @@
 #define BUZZER_GPIO_PORT GPIOA
 #define BUZZER_GPIO_PIN  GPIO_PIN_5
 
+#define BUZZER_QUEUE_LEN 16     // Notes, power of two
+#define TIMER_HZ         1000000UL  // TIM1 counter clock (prescaler 71)
+
 static TIM_HandleTypeDef *buzzer_htim = NULL;
 
-//extern TIM_HandleTypeDef *buzzer_htim;
+typedef struct {
+    uint16_t frequency;         // Hz, 0 = silence
+    uint16_t duration_ms;
+} Note;
+
+// Notes are queued from thread context and played from the TIM1 update interrupt
+static Note queue[BUZZER_QUEUE_LEN];
+static volatile uint8_t queue_head, queue_tail;
+static volatile bool playing;
+static uint32_t updates_left;   // Pin toggles (or 1 ms rest ticks) left in the current note
+static bool resting;
 
-void delay_us(uint16_t us)
+/* Loads the next note into TIM1, or stops the timer once the queue is empty */
+static void next_note(void)
 {
-    __HAL_TIM_SET_COUNTER(buzzer_htim, 0);  // reset counter
-    while (__HAL_TIM_GET_COUNTER(buzzer_htim) < us);
+    while (queue_head != queue_tail) {
+        Note n = queue[queue_head & (BUZZER_QUEUE_LEN - 1)];
+        queue_head++;
+        if (n.duration_ms == 0) continue;
+
+        HAL_GPIO_WritePin(BUZZER_GPIO_PORT, BUZZER_GPIO_PIN, GPIO_PIN_RESET);
+        resting = (n.frequency == 0);
+        if (resting) {
+            // Silence is timed in 1 ms updates
+            __HAL_TIM_SET_AUTORELOAD(buzzer_htim, TIMER_HZ / 1000 - 1);
+            updates_left = n.duration_ms;
+        } else {
+            // One update per half period toggles the pin
+            __HAL_TIM_SET_AUTORELOAD(buzzer_htim, TIMER_HZ / 2 / n.frequency - 1);
+            updates_left = 2UL * n.frequency * n.duration_ms / 1000;
+            if (updates_left == 0) updates_left = 1;
+        }
+        __HAL_TIM_SET_COUNTER(buzzer_htim, 0);
+
+        if (!playing) {
+            playing = true;
+            HAL_TIM_Base_Start_IT(buzzer_htim);
+        }
+        return;
+    }
+
+    HAL_TIM_Base_Stop_IT(buzzer_htim);
+    HAL_GPIO_WritePin(BUZZER_GPIO_PORT, BUZZER_GPIO_PIN, GPIO_PIN_RESET);
+    playing = false;
 }
 
-void playTone(uint16_t frequency, uint16_t duration_ms)
+/* Queue a tone (frequency 0 = pause); returns at once. Dropped if the queue is full. */
+static void playTone(uint16_t frequency, uint16_t duration_ms)
 {
-    uint32_t period_us = 1000000UL / frequency;
-    uint32_t cycles = (frequency * duration_ms) / 1000;
-
-    for (uint32_t i = 0; i < cycles; i++)
-    {
-        HAL_GPIO_WritePin(GPIOA, GPIO_PIN_5, GPIO_PIN_SET);
-        delay_us(period_us / 2);
-        HAL_GPIO_WritePin(GPIOA, GPIO_PIN_5, GPIO_PIN_RESET);
-        delay_us(period_us / 2);
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if ((uint8_t)(queue_tail - queue_head) < BUZZER_QUEUE_LEN) {
+        queue[queue_tail & (BUZZER_QUEUE_LEN - 1)] = (Note){ frequency, duration_ms };
+        queue_tail++;
+        if (!playing) next_note();
     }
+
+    if (!primask) __enable_irq();
+}
+
+void Buzzer_TimerTick(void)
+{
+    if (!resting) HAL_GPIO_TogglePin(BUZZER_GPIO_PORT, BUZZER_GPIO_PIN);
+    if (--updates_left == 0) next_note();
 }
 
+bool Buzzer_Busy(void)
+{
+    return playing;
+}
 
 void Buzzer_Init(TIM_HandleTypeDef *htim) {
     buzzer_htim = htim;
-    HAL_TIM_Base_Start(buzzer_htim); // Start TIM1
 }
 
 void Buzzer_Tick(void) {
@@ -43,16 +94,16 @@ void Buzzer_Short(void) {
 
 void Buzzer_Confirm(void) {
     playTone(1800, 50);
-    HAL_Delay(10);
+    playTone(0, 10);
     playTone(2200, 50);
 }
 
 void Buzzer_Startup(void) {
     playTone(1000, 50);
-    HAL_Delay(10);
+    playTone(0, 10);
     playTone(1400, 50);
-    HAL_Delay(10);
+    playTone(0, 10);
     playTone(1800, 50);
-    HAL_Delay(10);
+    playTone(0, 10);
 	playTone(0, 100);
 }
@@ -0,0 +1,116 @@
+#include "console.h"
+#include "params.h"
+#include "perf.h"
+#include <stdio.h>
+#include <string.h>
+
+#define RX_LEN      64      // Power of two: a few typed lines; no flow control, so send a line at a time
+#define LINE_LEN    40
+#define TX_TIMEOUT  100
+
+static UART_HandleTypeDef *huart;
+static uint8_t rx_byte;
+static uint8_t rx_buf[RX_LEN];
+static volatile uint8_t rx_head, rx_tail;  // Written by the interrupt, read by the thread
+static char line[LINE_LEN];
+static uint8_t line_len;
+static bool line_overflow;
+
+static void reply(const char *s) {
+    HAL_UART_Transmit(huart, (const uint8_t *)s, (uint16_t)strlen(s), TX_TIMEOUT);
+    HAL_UART_Transmit(huart, (const uint8_t *)"\r\n", 2, TX_TIMEOUT);
+}
+
+static void print_param(ParamId id) {
+    char value[12], out[LINE_LEN];
+    Params_Format(Params_Get(id), value, sizeof(value));
+    snprintf(out, sizeof(out), "%s %s", Params_Name(id), value);
+    reply(out);
+}
+
+static int find(const char *name) {
+    int id = name ? Params_Find(name) : -1;
+    if (id < 0) reply("error: unknown parameter");
+    return id;
+}
+
+static void execute(char *cmd) {
+    char *verb = strtok(cmd, " \t");
+    char *name = strtok(NULL, " \t");
+    char *value = strtok(NULL, " \t");
+    if (!verb) return;
+
+    if (strcmp(verb, "list") == 0) {
+        for (int i = 0; i < PARAM_COUNT; i++) print_param((ParamId)i);
+    } else if (strcmp(verb, "get") == 0) {
+        int id = find(name);
+        if (id >= 0) print_param((ParamId)id);
+    } else if (strcmp(verb, "set") == 0) {
+        int id = find(name);
+        int32_t milli;
+        if (id < 0) return;
+        if (!value || !Params_Parse(value, &milli)) {
+            reply("error: bad value");
+            return;
+        }
+        if (!Params_Set((ParamId)id, milli)) reply("clamped");
+        print_param((ParamId)id);
+    } else if (strcmp(verb, "save") == 0) {
+        reply(Params_Save() ? "saved" : "error: flash write failed");
+    } else if (strcmp(verb, "load") == 0) {
+        reply(Params_Load() ? "loaded" : "no saved parameters, defaults");
+    } else if (strcmp(verb, "defaults") == 0) {
+        Params_Defaults();
+        reply("defaults, not saved");
+    } else if (strcmp(verb, "perf") == 0) {
+        char out[60];
+        reply("zone      count       min      mean       max  (us)");
+        for (int i = 0; i < PERF_ZONE_COUNT; i++) {
+            Perf_Format((PerfZone)i, out, sizeof(out));
+            reply(out);
+        }
+    } else {
+        reply("commands: list, get NAME, set NAME VALUE, save, load, defaults, perf");
+    }
+}
+
+void Console_Init(UART_HandleTypeDef *uart) {
+    huart = uart;
+    HAL_UART_Receive_IT(huart, &rx_byte, 1);
+}
+
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *h) {
+    if (h != huart) return;
+    uint8_t next = (rx_head + 1) & (RX_LEN - 1);
+    if (next != rx_tail) {      // Full: the byte is dropped
+        rx_buf[rx_head] = rx_byte;
+        rx_head = next;
+    }
+    HAL_UART_Receive_IT(h, &rx_byte, 1);
+}
+
+// Overrun or framing error: the HAL has stopped receiving, start again
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *h) {
+    if (h == huart) HAL_UART_Receive_IT(h, &rx_byte, 1);
+}
+
+void Console_Service(void) {
+    if (!huart) return;
+
+    while (rx_tail != rx_head) {
+        char c = (char)rx_buf[rx_tail];
+        rx_tail = (rx_tail + 1) & (RX_LEN - 1);
+
+        if (c == '\r' || c == '\n') {
+            line[line_len] = '\0';
+            if (line_overflow) reply("error: line too long");
+            else execute(line);
+            line_len = 0;
+            line_overflow = false;
+        } else if (line_len < LINE_LEN - 1) {
+            line[line_len++] = c;
+        } else {
+            line_overflow = true;
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#include "display.h"
+#include "config.h"
+#include "motion.h"
+#include "MPU.h"
+#include "OLED.h"
+#include "perf.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+static struct {
+    const char *action;
+    int8_t fromX, fromY, toX, toY;
+    bool hasMove;
+    bool profile;
+    uint8_t page;           // Of the timing table
+    uint32_t page_since;    // HAL_GetTick() when that page came up
+    bool dirty;             // Posted since the last render
+} status;
+
+static uint32_t last_refresh;
+
+void Display_PostAction(const char *action) {
+    status.action = action;
+    status.profile = false;
+    status.dirty = true;
+}
+
+void Display_PostMove(int8_t fromX, int8_t fromY, int8_t toX, int8_t toY) {
+    status.fromX = fromX;
+    status.fromY = fromY;
+    status.toX = toX;
+    status.toY = toY;
+    status.hasMove = true;
+    status.profile = false;
+    status.dirty = true;
+}
+
+void Display_PostProfile(void) {
+    status.profile = true;
+    status.page = 0;
+    status.page_since = HAL_GetTick();
+    status.dirty = true;
+}
+
+static void render(void) {
+    status.dirty = false;
+    if (status.profile) {
+        if (status.page < PERF_DRAW_PAGES) {
+            Perf_Draw(status.page);
+            return;
+        }
+        // Behind the timing table: sensor health
+        char buf[24];
+        OLED_Clear();
+        OLED_Print("Sensors", 0, 0);
+        snprintf(buf, sizeof(buf), "Gyro clipped %lu", (unsigned long)MPU_SaturatedSamples());
+        OLED_Print(buf, 1, 0);
+        return;
+    }
+
+    OLED_Clear();
+    if (status.action) OLED_Print((char *)status.action, 0, 0);
+    if (status.hasMove) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "(%d,%d) -> (%d,%d)", status.fromX, status.fromY, status.toX, status.toY);
+        OLED_Print(buf, 2, 0);
+    }
+}
+
+void Display_Service(void) {
+    uint32_t now = HAL_GetTick();
+
+    // Menus draw straight into the framebuffer while idle; only throttle while moving
+    if (!Motion_Idle() && now - last_refresh < DISPLAY_REFRESH_MS) return;
+
+    // The timing table is taller than the panel: show one screen of it at a time
+    if (status.profile && now - status.page_since >= DISPLAY_PAGE_MS) {
+        status.page = (uint8_t)((status.page + 1) % (PERF_DRAW_PAGES + 1));
+        status.page_since = now;
+        status.dirty = true;
+    }
+
+    if (status.dirty) render();
+    if (OLED_Flush()) last_refresh = now;
+}
@@ -1,8 +1,12 @@
 #include "encoder.h"
 
+// Free-running 4x counts, only ever written by the EXTI callback
 volatile int32_t encoder_left_count = 0;
 volatile int32_t encoder_right_count = 0;
 
+// Last A/B state of each encoder, (A << 1) | B
+static uint8_t left_state, right_state;
+
 // ===== Pin defines =====
 #define LEFT_ENC_A_PORT GPIOB
 #define LEFT_ENC_A_PIN  GPIO_PIN_11
@@ -14,36 +18,45 @@ volatile int32_t encoder_right_count = 0;
 #define RIGHT_ENC_B_PORT GPIOB
 #define RIGHT_ENC_B_PIN  GPIO_PIN_15
 
-void ENCODER_Init(void)
+// Count step indexed by (previous state << 2) | new state. Forward is B leading A,
+// the direction the old A-rising/B-high decoding counted up. A transition where
+// both channels changed at once has lost an edge and counts nothing.
+static const int8_t QUAD_STEP[16] = {
+     0, +1, -1,  0,
+    -1,  0,  0, +1,
+    +1,  0,  0, -1,
+     0, -1, +1,  0
+};
+
+// Read both channels straight from IDR; the HAL call per pin costs more than the decode
+static inline uint8_t read_state(GPIO_TypeDef *a_port, uint16_t a_pin, GPIO_TypeDef *b_port, uint16_t b_pin)
+{
+    return (uint8_t)(((a_port->IDR & a_pin) ? 2 : 0) | ((b_port->IDR & b_pin) ? 1 : 0));
+}
+
+static void init_pin(GPIO_TypeDef *port, uint16_t pin)
 {
     GPIO_InitTypeDef GPIO_InitStruct = {0};
+    GPIO_InitStruct.Pin = pin;
+    GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING_FALLING;
+    GPIO_InitStruct.Pull = GPIO_PULLUP;
+    HAL_GPIO_Init(port, &GPIO_InitStruct);
+}
 
+void ENCODER_Init(void)
+{
     __HAL_RCC_GPIOA_CLK_ENABLE();
     __HAL_RCC_GPIOB_CLK_ENABLE();
 
-    // Left A pin EXTI
-    GPIO_InitStruct.Pin = LEFT_ENC_A_PIN;
-    GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
-    GPIO_InitStruct.Pull = GPIO_PULLUP;
-    HAL_GPIO_Init(LEFT_ENC_A_PORT, &GPIO_InitStruct);
-
-    // Left B pin input
-    GPIO_InitStruct.Pin = LEFT_ENC_B_PIN;
-    GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
-    GPIO_InitStruct.Pull = GPIO_PULLUP;
-    HAL_GPIO_Init(LEFT_ENC_B_PORT, &GPIO_InitStruct);
-
-    // Right A pin EXTI
-    GPIO_InitStruct.Pin = RIGHT_ENC_A_PIN;
-    GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
-    GPIO_InitStruct.Pull = GPIO_PULLUP;
-    HAL_GPIO_Init(RIGHT_ENC_A_PORT, &GPIO_InitStruct);
+    // Both edges of both channels interrupt (TIM encoder mode needs CH1/CH2
+    // of one timer, which these pins are not)
+    init_pin(LEFT_ENC_A_PORT, LEFT_ENC_A_PIN);
+    init_pin(LEFT_ENC_B_PORT, LEFT_ENC_B_PIN);
+    init_pin(RIGHT_ENC_A_PORT, RIGHT_ENC_A_PIN);
+    init_pin(RIGHT_ENC_B_PORT, RIGHT_ENC_B_PIN);
 
-    // Right B pin input
-    GPIO_InitStruct.Pin = RIGHT_ENC_B_PIN;
-    GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
-    GPIO_InitStruct.Pull = GPIO_PULLUP;
-    HAL_GPIO_Init(RIGHT_ENC_B_PORT, &GPIO_InitStruct);
+    left_state = read_state(LEFT_ENC_A_PORT, LEFT_ENC_A_PIN, LEFT_ENC_B_PORT, LEFT_ENC_B_PIN);
+    right_state = read_state(RIGHT_ENC_A_PORT, RIGHT_ENC_A_PIN, RIGHT_ENC_B_PORT, RIGHT_ENC_B_PIN);
 
     // Enable EXTI IRQ
     HAL_NVIC_SetPriority(EXTI15_10_IRQn, 0, 0);
@@ -53,14 +66,6 @@ void ENCODER_Init(void)
     HAL_NVIC_EnableIRQ(EXTI9_5_IRQn);
 }
 
-void ENCODER_ResetLeft(void){
-	encoder_left_count = 0;
-}
-
-void ENCODER_ResetRight(void){
-	encoder_right_count = 0;
-}
-
 int32_t ENCODER_GetLeft(void)
 {
     return encoder_left_count;
@@ -71,21 +76,28 @@ int32_t ENCODER_GetRight(void)
     return encoder_right_count;
 }
 
+void ENCODER_Read(int32_t *left, int32_t *right)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *left = encoder_left_count;
+    *right = encoder_right_count;
+    if (!primask) __enable_irq();
+}
+
 // EXTI callback
 void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
 {
-    if (GPIO_Pin == LEFT_ENC_A_PIN)
+    if (GPIO_Pin == LEFT_ENC_A_PIN || GPIO_Pin == LEFT_ENC_B_PIN)
     {
-        if (HAL_GPIO_ReadPin(LEFT_ENC_B_PORT, LEFT_ENC_B_PIN))
-            encoder_left_count++;
-        else
-            encoder_left_count--;
+        uint8_t state = read_state(LEFT_ENC_A_PORT, LEFT_ENC_A_PIN, LEFT_ENC_B_PORT, LEFT_ENC_B_PIN);
+        encoder_left_count += QUAD_STEP[left_state << 2 | state];
+        left_state = state;
     }
-    else if (GPIO_Pin == RIGHT_ENC_A_PIN)
+    else if (GPIO_Pin == RIGHT_ENC_A_PIN || GPIO_Pin == RIGHT_ENC_B_PIN)
     {
-        if (HAL_GPIO_ReadPin(RIGHT_ENC_B_PORT, RIGHT_ENC_B_PIN))
-            encoder_right_count++;
-        else
-            encoder_right_count--;
+        uint8_t state = read_state(RIGHT_ENC_A_PORT, RIGHT_ENC_A_PIN, RIGHT_ENC_B_PORT, RIGHT_ENC_B_PIN);
+        encoder_right_count += QUAD_STEP[right_state << 2 | state];
+        right_state = state;
     }
 }
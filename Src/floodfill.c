@@ -1,47 +1,162 @@
 #include "floodfill.h"
+#include "config.h"
 #include "motion.h"
-#include "OLED.h"
-#include <stdio.h>
+#include "display.h"
+#include "perf.h"
 
 // Maze and robot state
-static Cell maze[W][H];
+static MazeWalls walls;
+static uint8_t dist[W][H];        // to the current targets, unknown walls open
+static uint8_t distGoal[W][H];    // to the goal, unknown walls open
+static uint8_t distClosed[W][H];  // to the goal, unknown walls closed
+static uint8_t distHome[W][H];    // to the start cell, unknown walls open
+static uint16_t target[H];        // row masks of the cells dist[] counts from
+static uint16_t goalCells[H];     // row masks of the goal cells
+static const uint16_t homeCell[H] = { 1 };
 static int8_t x, y;
 static int8_t goalX = W/2, goalY = H/2;
 static Direction currentDir;
 
-// ===== Queue Implementation =====
+// Search: reach the goal, explore until the route is settled, drive home
+typedef enum { SEARCH_TO_GOAL, SEARCH_EXPLORE, SEARCH_RETURN } SearchPhase;
+static SearchPhase phase;
+
+// Distance fields kept up to date as walls are learned: each is flooded once,
+// then repaired from the cells beside every wall or seed that changed since
 typedef struct {
-    Pair data[W * H];
-    int front, rear;
-} Queue;
+    uint8_t (*dist)[H];
+    const uint16_t *seed;   // row masks of the cells it counts from
+    bool closed;            // unknown walls count as walls
+    bool valid;             // flooded, with every change since in stale[]
+    uint16_t stale[H];      // row masks of the cells to re-check
+} Field;
+
+enum { FIELD_TARGET, FIELD_GOAL, FIELD_CLOSED, FIELD_HOME, FIELD_COUNT };
+
+static Field fields[FIELD_COUNT] = {
+    [FIELD_TARGET] = { dist,       target,    false },
+    [FIELD_GOAL]   = { distGoal,   goalCells, false },
+    [FIELD_CLOSED] = { distClosed, goalCells, true  },
+    [FIELD_HOME]   = { distHome,   homeCell,  false },
+};
+
+// Repair work list, shared: one field is repaired at a time
+static Pair dirty[W * H];
+static int dirtyCount;
+static uint16_t dirtyQueued[H];  // row bitmasks of cells in dirty[]
+
+// Time-cost planner over (cell, heading) states, Dial's buckets kept as counts only:
+// each cost level is a scan for its states, which saves a link per state (2 KB)
+#define PLAN_STATES     (W * H * 4)
+#define PLAN_UNREACHED  0xFFFF
+#define PLAN_MAX_EDGE   ((PLAN_COST_TURN180 > PLAN_COST_TURN90) ? \
+                         ((PLAN_COST_TURN180 > PLAN_COST_STRAIGHT) ? PLAN_COST_TURN180 : PLAN_COST_STRAIGHT) : \
+                         ((PLAN_COST_TURN90 > PLAN_COST_STRAIGHT) ? PLAN_COST_TURN90 : PLAN_COST_STRAIGHT))
+#define PLAN_BUCKETS    (PLAN_MAX_EDGE + 1)
+
+_Static_assert(PLAN_COST_STRAIGHT > 0 && PLAN_COST_TURN90 > 0 && PLAN_COST_TURN180 > 0,
+               "a cost level is final once scanned only if every edge costs something");
+
+static uint16_t planCost[PLAN_STATES];  // cost-to-goal of each state
+static uint16_t planCount[PLAN_BUCKETS]; // states waiting at each cost, modulo PLAN_BUCKETS
+static int planPending;
+static bool planClosed;  // treat unknown walls as closed
+
+static const int8_t stepX[4] = { 0, 1, 0, -1 };
+static const int8_t stepY[4] = { 1, 0, -1, 0 };
 
-static void queue_init(Queue* q) {
-    q->front = q->rear = 0;
+// ===== Internal helpers =====
+static inline bool check(int8_t xx, int8_t yy) {
+    return xx >= 0 && xx < W && yy >= 0 && yy < H;
 }
 
-static void queue_push(Queue* q, Pair p) {
-    q->data[q->rear++] = p;
+static Direction rightDir(void) {
+    return (Direction)((currentDir + 1) % 4);
 }
 
-static Pair queue_pop(Queue* q) {
-    return q->data[q->front++];
+static Direction leftDir(void) {
+    return (Direction)((currentDir + 3) % 4);
 }
 
-static bool queue_empty(Queue* q) {
-    return q->front >= q->rear;
+static bool isGoalCell(int8_t xx, int8_t yy) {
+    if (xx == goalX && yy == goalY) return true;
+    int cx = W / 2 - ((W & 1) ^ 1);
+    int cy = H / 2 - ((H & 1) ^ 1);
+    return xx >= cx && xx <= W / 2 && yy >= cy && yy <= H / 2;
 }
 
-// ===== Internal helpers =====
-static inline bool check(int8_t xx, int8_t yy) {
-    return xx >= 0 && xx < W && yy >= 0 && yy < H;
+static void markDirty(int8_t xx, int8_t yy) {
+    if (!check(xx, yy) || (dirtyQueued[yy] >> xx & 1)) return;
+    dirtyQueued[yy] |= (uint16_t)(1u << xx);
+    dirty[dirtyCount++] = (Pair){xx, yy};
 }
 
-static Direction rightDir(void) {
-    return (Direction)((currentDir + 1) % 4);
+// A wall beside the cell changed: every field counting through it re-checks it
+static void markStale(int8_t xx, int8_t yy) {
+    if (!check(xx, yy)) return;
+    for (int f = 0; f < FIELD_COUNT; f++) {
+        if (fields[f].valid) fields[f].stale[yy] |= (uint16_t)(1u << xx);
+    }
 }
 
-static Direction leftDir(void) {
-    return (Direction)((currentDir + 3) % 4);
+static void setWall(int8_t xx, int8_t yy, Direction d, bool wall) {
+    if (!Maze_SetWall(&walls, xx, yy, d, wall)) return;
+
+    // Both sides of the changed wall may need a new distance
+    markStale(xx, yy);
+    switch (d) {
+        case North: markStale(xx, yy + 1); break;
+        case East:  markStale(xx + 1, yy); break;
+        case South: markStale(xx, yy - 1); break;
+        case West:  markStale(xx - 1, yy); break;
+    }
+}
+
+// The field's flood can step from the cell out through this side
+static bool passable(const Field *f, int8_t xx, int8_t yy, Direction d) {
+    if (Maze_HasWall(&walls, xx, yy, d)) return false;
+    return !f->closed || Maze_IsKnown(&walls, xx, yy, d);
+}
+
+// Smallest distance among neighbours the flood can step from into this cell
+static uint8_t minNeighbourDist(const Field *f, int8_t xx, int8_t yy) {
+    uint8_t best = 255;
+    for (int dir = 0; dir < 4; dir++) {
+        int8_t nx = xx, ny = yy;
+        switch (dir) {
+            case North: ny++; break;
+            case East:  nx++; break;
+            case South: ny--; break;
+            case West:  nx--; break;
+        }
+        if (check(nx, ny) && passable(f, xx, yy, (Direction)dir) && f->dist[nx][ny] < best)
+            best = f->dist[nx][ny];
+    }
+    return best;
+}
+
+// Goal cell plus the center cells for an even-dimensioned maze
+static void goalSeed(uint16_t seed[H]) {
+    for (int j = 0; j < H; j++) {
+        seed[j] = 0;
+        for (int i = 0; i < W; i++) {
+            if (isGoalCell(i, j)) seed[j] |= (uint16_t)(1u << i);
+        }
+    }
+}
+
+// Cells that became or stopped being targets are re-checked like a changed
+// wall's. A set sharing no cell with the old one floods afresh: counting the
+// whole maze up from the old targets would cost more
+static void setTargets(const uint16_t seed[H]) {
+    Field *f = &fields[FIELD_TARGET];
+    bool overlap = false;
+    for (int j = 0; j < H; j++) {
+        if (target[j] & seed[j]) overlap = true;
+        f->stale[j] |= target[j] ^ seed[j];
+        target[j] = seed[j];
+    }
+    if (!overlap) f->valid = false;
 }
 
 // ===== API =====
@@ -50,90 +165,194 @@ void FloodFill_Init(void) {
     x = 0;
     y = 0;
     currentDir = North;
+    phase = SEARCH_TO_GOAL;
 
+    Maze_Clear(&walls);
     for (int i = 0; i < W; i++) {
         for (int j = 0; j < H; j++) {
-            for (int d = 0; d < 4; d++) {
-                maze[i][j].walls[d] = false;
-            }
-            maze[i][j].dist = 255;
+            dist[i][j] = 255;
         }
     }
+    for (int j = 0; j < H; j++) {
+        dirtyQueued[j] = 0;
+    }
+    dirtyCount = 0;
+    for (int f = 0; f < FIELD_COUNT; f++) {
+        fields[f].valid = false;
+    }
+
+    goalSeed(goalCells);
+    setTargets(goalCells);
+}
+
+void FloodFill_ResetPose(void) {
+    x = 0;
+    y = 0;
+    currentDir = North;
+}
+
+void FloodFill_LoadMaze(const MazeWalls *m) {
+    FloodFill_Init();
+    walls = *m;
 }
 
 void FloodFill_SetGoal(int gx, int gy) {
     if (check(gx, gy)) {
         goalX = gx;
         goalY = gy;
+        goalSeed(goalCells);
+        fields[FIELD_GOAL].valid = fields[FIELD_CLOSED].valid = false;
+        if (phase == SEARCH_TO_GOAL) setTargets(goalCells);
     }
 }
 
 void FloodFill_UpdateWalls(bool wallFront, bool wallRight, bool wallLeft) {
     // Update walls for current cell based on current direction
-    maze[x][y].walls[currentDir] = wallFront;
-    maze[x][y].walls[rightDir()] = wallRight;
-    maze[x][y].walls[leftDir()] = wallLeft;
+    setWall(x, y, currentDir, wallFront);
+    setWall(x, y, rightDir(), wallRight);
+    setWall(x, y, leftDir(), wallLeft);
+
+    // Neighbouring cells share the stored wall, so no mirroring is needed
+}
 
-    // Mirror walls to neighboring cells
-    if (maze[x][y].walls[North] && check(x, y + 1))
-        maze[x][y + 1].walls[South] = true;
-    if (maze[x][y].walls[East] && check(x + 1, y))
-        maze[x + 1][y].walls[West] = true;
-    if (maze[x][y].walls[South] && check(x, y - 1))
-        maze[x][y - 1].walls[North] = true;
-    if (maze[x][y].walls[West] && check(x - 1, y))
-        maze[x - 1][y].walls[East] = true;
+// A full flood supersedes any pending repair
+static void flood(Field *f) {
+    uint32_t t0 = Perf_Begin();
+    Maze_Flood(&walls, f->seed, f->closed, f->dist);
+    for (int j = 0; j < H; j++) {
+        f->stale[j] = 0;
+    }
+    f->valid = true;
+    Perf_End(PERF_FLOOD_RUN, t0);
 }
 
 void FloodFill_Run(void) {
-    Queue q;
-    queue_init(&q);
+    flood(&fields[FIELD_TARGET]);
+}
 
-    // Initialize distances to 255
-    for (int i = 0; i < W; i++) {
-        for (int j = 0; j < H; j++) {
-            maze[i][j].dist = 255;
-        }
+/**
+ * Repairs a field after wall or seed changes instead of re-flooding the whole
+ * maze. Starts from its stale cells and only spreads to neighbours whose
+ * distance actually moved. Does nothing if nothing changed.
+ */
+static void repair(Field *f) {
+    if (!f->valid) {
+        flood(f);
+        return;
     }
 
-    // Mark the goal cell's distance as 0 and add it to the queue
-    maze[goalX][goalY].dist = 0;
-    Pair p = {goalX, goalY};
-    queue_push(&q, p);
-
-    // Optionally support center cells goal for even-dimensioned maze
-    int cx = W / 2 - ((W & 1) ^ 1);
-    int cy = H / 2 - ((H & 1) ^ 1);
-    for (int i = cx; i <= W / 2; i++) {
-        for (int j = cy; j <= H / 2; j++) {
-            maze[i][j].dist = 0;
-            Pair p = {i, j};
-            queue_push(&q, p);
+    for (int j = 0; j < H; j++) {
+        for (uint16_t bits = f->stale[j]; bits; bits &= bits - 1) {
+            markDirty(__builtin_ctz(bits), j);
         }
+        f->stale[j] = 0;
     }
 
-    // BFS to calculate distances to goal
-    while (!queue_empty(&q)) {
-        Pair p = queue_pop(&q);
+    // Cut-off walls can make a region count up slowly to 255; fall back then
+    int budget = 4 * W * H;
+
+    while (dirtyCount > 0) {
+        Pair p = dirty[--dirtyCount];
         int8_t xq = p.F, yq = p.S;
+        dirtyQueued[yq] &= (uint16_t)~(1u << xq);
 
+        if (--budget < 0) {
+            for (int j = 0; j < H; j++) {
+                dirtyQueued[j] = 0;
+            }
+            dirtyCount = 0;
+            flood(f);
+            return;
+        }
+
+        uint8_t want = 0;
+        if (!(f->seed[yq] >> xq & 1)) {
+            uint8_t best = minNeighbourDist(f, xq, yq);
+            want = (best == 255) ? 255 : best + 1;
+        }
+        if (f->dist[xq][yq] == want) continue;
+        f->dist[xq][yq] = want;
+
+        // Neighbours relied on the old value; re-check them
         for (int dir = 0; dir < 4; dir++) {
-            if (!maze[xq][yq].walls[dir]) {
-                int8_t nx = xq, ny = yq;
-                switch (dir) {
-                    case North: ny++; break;
-                    case East: nx++; break;
-                    case South: ny--; break;
-                    case West: nx--; break;
-                }
-                if (check(nx, ny) && maze[nx][ny].dist > maze[xq][yq].dist + 1) {
-                    maze[nx][ny].dist = maze[xq][yq].dist + 1;
-                    Pair np = {nx, ny};
-                    queue_push(&q, np);
+            if (!passable(f, xq, yq, (Direction)dir)) continue;
+            switch (dir) {
+                case North: markDirty(xq, yq + 1); break;
+                case East:  markDirty(xq + 1, yq); break;
+                case South: markDirty(xq, yq - 1); break;
+                case West:  markDirty(xq - 1, yq); break;
+            }
+        }
+    }
+}
+
+void FloodFill_Update(void) {
+    uint32_t t0 = Perf_Begin();
+    repair(&fields[FIELD_TARGET]);
+    Perf_End(PERF_FLOOD_UPDATE, t0);
+}
+
+/**
+ * Exploration is finished once the shortest start-to-goal distance is the same
+ * with unknown walls open and closed: no unseen wall can shorten the route.
+ */
+bool FloodFill_ExplorationDone(void) {
+    repair(&fields[FIELD_GOAL]);
+    repair(&fields[FIELD_CLOSED]);
+
+    // Run start is the bottom-left corner cell; 255 there means no route at all
+    return distGoal[0][0] != 255 && distClosed[0][0] == distGoal[0][0];
+}
+
+/**
+ * Cells on a shortest start-to-goal route (unknown walls open) whose distance
+ * still differs between the open and closed floods and that have a wall not
+ * seen yet. Their walls are the ones that can change the route. Uses the
+ * fields as the last FloodFill_ExplorationDone() left them; false when there are none.
+ */
+static bool exploreTargets(uint16_t seed[H]) {
+    repair(&fields[FIELD_HOME]);
+
+    uint8_t route = distGoal[0][0];
+    bool any = false;
+    for (int j = 0; j < H; j++) {
+        seed[j] = 0;
+        for (int i = 0; i < W; i++) {
+            if (route == 255 || distHome[i][j] + distGoal[i][j] != route) continue;
+            if (distClosed[i][j] == distGoal[i][j]) continue;
+            for (int dir = 0; dir < 4; dir++) {
+                if (!Maze_IsKnown(&walls, i, j, (Direction)dir)) {
+                    seed[j] |= (uint16_t)(1u << i);
+                    any = true;
+                    break;
                 }
             }
         }
     }
+    return any;
+}
+
+bool FloodFill_SearchDone(void) {
+    uint16_t seed[H];
+
+    if (phase == SEARCH_TO_GOAL && isGoalCell(x, y)) phase = SEARCH_EXPLORE;
+
+    if (phase == SEARCH_EXPLORE) {
+        if (!FloodFill_ExplorationDone() && exploreTargets(seed)) {
+            setTargets(seed);
+        } else {
+            for (int j = 0; j < H; j++) seed[j] = 0;
+            seed[0] = 1;
+            setTargets(seed);
+            phase = SEARCH_RETURN;
+        }
+    }
+
+    if (phase == SEARCH_RETURN && x == 0 && y == 0) return true;
+
+    // No route left to the targets: stop where the robot stands
+    FloodFill_Update();
+    return dist[x][y] == 255;
 }
 
 void FloodFill_MoveStep(void) {
@@ -143,7 +362,7 @@ void FloodFill_MoveStep(void) {
 
     // Find neighbor with smallest distance
     for (int dir = 0; dir < 4; dir++) {
-        if (!maze[x][y].walls[dir]) {
+        if (!Maze_HasWall(&walls, x, y, dir)) {
             int8_t nx = x, ny = y;
             switch (dir) {
                 case North: ny++; break;
@@ -151,41 +370,32 @@ void FloodFill_MoveStep(void) {
                 case South: ny--; break;
                 case West: nx--; break;
             }
-            if (check(nx, ny) && maze[nx][ny].dist < bestDist) {
-                bestDist = maze[nx][ny].dist;
+            if (check(nx, ny) && dist[nx][ny] < bestDist) {
+                bestDist = dist[nx][ny];
                 bestDir = (Direction)dir;
             }
         }
     }
 
-    // Rotate towards best direction
+    // Queue the rotation towards the best direction and the cell move;
+    // the status posted below is drawn later by the display service
     int rotation = (bestDir - currentDir + 4) % 4;
     switch (rotation) {
-        case 1:
-            OLED_Clear();
-            OLED_Print("Turn Right", 0, 0);
-            turn90(false);
-            break;
-        case 2:
-            OLED_Clear();
-            OLED_Print("Turn 180", 0, 0);
-            turn180();
-            break;
-        case 3:
-            OLED_Clear();
-            OLED_Print("Turn Left", 0, 0);
-            turn90(true);
-            break;
-        default:
-            OLED_Clear();
-            OLED_Print("Forward", 0, 0);
-            break;
+        case 1: Motion_Enqueue((Move){ MOVE_TURN_RIGHT, 0 }); break;
+        case 2: Motion_Enqueue((Move){ MOVE_TURN_AROUND, 0 }); break;
+        case 3: Motion_Enqueue((Move){ MOVE_TURN_LEFT, 0 }); break;
+        default: break;
     }
+    Motion_Enqueue((Move){ MOVE_STRAIGHT, 2 });
 
     currentDir = bestDir;
 
-    // Move forward one cell physically
-    driveForward(1);
+    switch (rotation) {
+        case 1: Display_PostAction("Turn Right"); break;
+        case 2: Display_PostAction("Turn 180"); break;
+        case 3: Display_PostAction("Turn Left"); break;
+        default: Display_PostAction("Forward"); break;
+    }
 
     // Update internal coordinates
     switch (currentDir) {
@@ -196,9 +406,7 @@ void FloodFill_MoveStep(void) {
     }
 
     // Show coordinate transition
-    char buf[32];
-    snprintf(buf, sizeof(buf), "(%d,%d) -> (%d,%d)", fromX, fromY, x, y);
-    OLED_Print(buf, 2, 0);
+    Display_PostMove(fromX, fromY, x, y);
 }
 
 void FloodFill_GetBestPath(Direction path[], int *length) {
@@ -207,13 +415,16 @@ void FloodFill_GetBestPath(Direction path[], int *length) {
     Direction cdir = currentDir;
     int idx = 0;
 
-    while (!(cx == goalX && cy == goalY)) {
+    // dist[] may be counting to exploration targets or home
+    repair(&fields[FIELD_GOAL]);
+
+    while (!isGoalCell(cx, cy) && idx < W * H) {
         uint8_t bestDist = 255;
         Direction bestDir = cdir;
 
         // Find neighbor with smallest distance
         for (int dir = 0; dir < 4; dir++) {
-            if (!maze[cx][cy].walls[dir]) {
+            if (!Maze_HasWall(&walls, cx, cy, dir)) {
                 int nx = cx, ny = cy;
                 switch (dir) {
                     case North: ny++; break;
@@ -221,8 +432,8 @@ void FloodFill_GetBestPath(Direction path[], int *length) {
                     case South: ny--; break;
                     case West:  nx--; break;
                 }
-                if (check(nx, ny) && maze[nx][ny].dist < bestDist) {
-                    bestDist = maze[nx][ny].dist;
+                if (check(nx, ny) && distGoal[nx][ny] < bestDist) {
+                    bestDist = distGoal[nx][ny];
                     bestDir = (Direction)dir;
                 }
             }
@@ -243,28 +454,149 @@ void FloodFill_GetBestPath(Direction path[], int *length) {
     *length = idx;
 }
 
-void FloodFill_RunBestPath(void) {
-    Direction path[W*H];
+static inline int planState(int xx, int yy, int h) {
+    return ((xx * H) + yy) * 4 + h;
+}
+
+static inline bool planBlocked(int xx, int yy, int h) {
+    return Maze_HasWall(&walls, xx, yy, (Direction)h) ||
+           (planClosed && !Maze_IsKnown(&walls, xx, yy, (Direction)h));
+}
+
+static void planRelax(int s, uint16_t cost) {
+    if (cost >= planCost[s]) return;
+
+    if (planCost[s] == PLAN_UNREACHED) planPending++;
+    else planCount[planCost[s] % PLAN_BUCKETS]--;
+
+    planCost[s] = cost;
+    planCount[cost % PLAN_BUCKETS]++;
+}
+
+/**
+ * Dijkstra from the goal cells backwards over (cell, heading) states, so that
+ * planCost[] holds the minimum time to the goal using the PLAN_COST_* weights.
+ */
+static void planRun(void) {
+    for (int s = 0; s < PLAN_STATES; s++) planCost[s] = PLAN_UNREACHED;
+    for (int b = 0; b < PLAN_BUCKETS; b++) planCount[b] = 0;
+    planPending = 0;
+
+    for (int i = 0; i < W; i++) {
+        for (int j = 0; j < H; j++) {
+            if (!isGoalCell(i, j)) continue;
+            for (int h = 0; h < 4; h++) planRelax(planState(i, j, h), 0);
+        }
+    }
+
+    for (uint32_t d = 0; planPending > 0; d++) {
+        uint16_t *count = &planCount[d % PLAN_BUCKETS];
+
+        // Every edge costs something, so the states at d are final and relaxing adds none at d
+        for (int s = 0; *count > 0 && s < PLAN_STATES; s++) {
+            if (planCost[s] != d) continue;
+            (*count)--;
+            planPending--;
+
+            int h = s & 3;
+            int cx = (s >> 2) / H;
+            int cy = (s >> 2) % H;
+
+            // Arrived here by driving one cell along h
+            int px = cx - stepX[h], py = cy - stepY[h];
+            if (check(px, py) && !planBlocked(px, py, h))
+                planRelax(planState(px, py, h), d + PLAN_COST_STRAIGHT);
+
+            // Arrived here by turning in place
+            planRelax(planState(cx, cy, (h + 1) % 4), d + PLAN_COST_TURN90);
+            planRelax(planState(cx, cy, (h + 3) % 4), d + PLAN_COST_TURN90);
+            planRelax(planState(cx, cy, (h + 2) % 4), d + PLAN_COST_TURN180);
+        }
+    }
+}
+
+/**
+ * Minimum-time path from the current pose to the goal, where turns are priced
+ * separately from straight cells. Same output format as FloodFill_GetBestPath.
+ * Only walls seen open are used, unless no such route exists yet.
+ */
+void FloodFill_GetFastestPath(Direction path[], int *length) {
+    int cx = x, cy = y;
+    int h = currentDir;
+    int idx = 0;
+
+    planClosed = true;
+    planRun();
+    if (planCost[planState(cx, cy, h)] == PLAN_UNREACHED) {
+        planClosed = false;
+        planRun();
+    }
+
+    if (planCost[planState(cx, cy, h)] == PLAN_UNREACHED) {
+        *length = 0;
+        return;
+    }
+
+    while (!isGoalCell(cx, cy) && idx < W * H) {
+        // Prefer driving straight when it ties with a turn
+        int bestH = h;
+        uint32_t best = PLAN_UNREACHED;
+        if (!planBlocked(cx, cy, h))
+            best = (uint32_t)planCost[planState(cx + stepX[h], cy + stepY[h], h)] + PLAN_COST_STRAIGHT;
+
+        static const uint8_t turnCost[4] = { 0, PLAN_COST_TURN90, PLAN_COST_TURN180, PLAN_COST_TURN90 };
+        for (int r = 1; r < 4; r++) {
+            int nh = (h + r) % 4;
+            uint32_t c = (uint32_t)planCost[planState(cx, cy, nh)] + turnCost[r];
+            if (c < best) {
+                best = c;
+                bestH = nh;
+            }
+        }
+
+        if (bestH != h) {
+            h = bestH;
+            continue;
+        }
+
+        path[idx++] = (Direction)h;
+        cx += stepX[h];
+        cy += stepY[h];
+    }
+    *length = idx;
+}
+
+void FloodFill_RunBestPath(bool diagonals) {
+    static Direction path[W*H];
+    static Move moves[2*W*H];
     int length = 0;
-    FloodFill_GetBestPath(path, &length);
+    FloodFill_GetFastestPath(path, &length);
+    if (length == 0) return;
+
+    int count = compilePath(path, length, currentDir, moves);
+
+    // Staircases become diagonal runs
+    if (diagonals) {
+        static Move diagonals[2*W*H];
+        count = compileDiagonals(moves, count, diagonals);
+        runMoves(diagonals, count);
+    } else {
+        runMoves(moves, count);
+    }
+
+    // Stalled partway: the pose is lost, and the run is over anyway
+    if (Motion_Stalled()) return;
 
+    // Advance the pose to where the path ends
     for (int i = 0; i < length; i++) {
-        Direction nextDir = path[i];
-        int rotation = (nextDir - currentDir + 4) % 4;
-
-        switch (rotation) {
-            case 1: turn90(false); break;
-            case 2: turn180(); break;
-            case 3: turn90(true); break;
-            default: break;
-        }
-        currentDir = nextDir;
-        driveForward(1);
+        x += stepX[path[i]];
+        y += stepY[path[i]];
     }
+    currentDir = path[length - 1];
 }
 
 bool FloodFill_AtGoal(void) {
-    return (x == goalX && y == goalY);
+    return isGoalCell(x, y);
 }
 
 int8_t FloodFill_GetX(void) { return x; }
@@ -272,3 +604,5 @@ int8_t FloodFill_GetX(void) { return x; }
 int8_t FloodFill_GetY(void) { return y; }
 
 Direction FloodFill_GetDir(void) { return currentDir; }
+
+const MazeWalls *FloodFill_GetWalls(void) { return &walls; }
@@ -0,0 +1,162 @@
+#include "i2cbus.h"
+#include <string.h>
+
+typedef struct {
+    uint8_t addr;
+    uint8_t reg_size;
+    uint16_t reg;
+    bool read;
+    uint16_t len;
+    uint8_t *data;                  // Points at inline_data for short writes
+    uint8_t inline_data[I2C_INLINE_MAX];
+    I2CBus_Callback done;
+    void *ctx;
+} I2CJob;
+
+typedef struct {
+    I2CJob jobs[I2C_QUEUE_LEN];
+    uint8_t head, tail;
+} I2CQueue;
+
+static I2C_HandleTypeDef *bus;
+static I2CQueue queues[I2C_PRIO_COUNT];
+static I2CJob current;
+static volatile bool busy;
+
+static inline uint32_t lock(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    return primask;
+}
+
+static inline void unlock(uint32_t primask) {
+    if (!primask) __enable_irq();
+}
+
+static HAL_StatusTypeDef start_job(I2CJob *job) {
+    // Long writes (display pages) by DMA: one interrupt per transfer instead of per byte
+    bool dma = !job->read && job->len >= I2C_DMA_MIN && bus->hdmatx != NULL;
+
+    if (job->reg_size == 0) {
+        if (dma) return HAL_I2C_Master_Transmit_DMA(bus, job->addr, job->data, job->len);
+        return job->read ? HAL_I2C_Master_Receive_IT(bus, job->addr, job->data, job->len)
+                         : HAL_I2C_Master_Transmit_IT(bus, job->addr, job->data, job->len);
+    }
+    uint16_t size = (job->reg_size == 2) ? I2C_MEMADD_SIZE_16BIT : I2C_MEMADD_SIZE_8BIT;
+    if (dma) return HAL_I2C_Mem_Write_DMA(bus, job->addr, job->reg, size, job->data, job->len);
+    return job->read ? HAL_I2C_Mem_Read_IT(bus, job->addr, job->reg, size, job->data, job->len)
+                     : HAL_I2C_Mem_Write_IT(bus, job->addr, job->reg, size, job->data, job->len);
+}
+
+/* Starts the highest-priority waiting job. Called with interrupts locked or from the bus IRQ. */
+static void start_next(void) {
+    for (;;) {
+        int p = 0;
+        while (p < I2C_PRIO_COUNT && queues[p].head == queues[p].tail) p++;
+        if (p == I2C_PRIO_COUNT) {
+            busy = false;
+            return;
+        }
+
+        I2CQueue *q = &queues[p];
+        current = q->jobs[q->head & (I2C_QUEUE_LEN - 1)];
+        q->head++;
+        if (current.data == NULL) current.data = current.inline_data;
+        busy = true;
+
+        HAL_StatusTypeDef status = start_job(&current);
+        if (status == HAL_OK) return;
+
+        // Could not even start: report it and move on
+        if (current.done) current.done(current.ctx, status);
+    }
+}
+
+static void finish(HAL_StatusTypeDef status) {
+    I2CJob job = current;
+    if (job.done) job.done(job.ctx, status);
+    start_next();
+}
+
+static bool submit(I2CPriority prio, uint8_t addr, uint16_t reg, uint8_t reg_size, bool read,
+                   uint8_t *data, uint16_t len, I2CBus_Callback done, void *ctx) {
+    uint32_t key = lock();
+    I2CQueue *q = &queues[prio];
+    if ((uint8_t)(q->tail - q->head) >= I2C_QUEUE_LEN) {
+        unlock(key);
+        return false;
+    }
+
+    I2CJob *job = &q->jobs[q->tail & (I2C_QUEUE_LEN - 1)];
+    job->addr = addr;
+    job->reg = reg;
+    job->reg_size = reg_size;
+    job->read = read;
+    job->len = len;
+    job->done = done;
+    job->ctx = ctx;
+    if (!read && len <= I2C_INLINE_MAX) {
+        memcpy(job->inline_data, data, len);
+        job->data = NULL;           // Resolved to inline_data once the job is copied out
+    } else {
+        job->data = data;
+    }
+    q->tail++;
+
+    if (!busy) start_next();
+    unlock(key);
+    return true;
+}
+
+void I2CBus_Init(I2C_HandleTypeDef *hi2c) {
+    bus = hi2c;
+}
+
+bool I2CBus_Read(I2CPriority prio, uint8_t addr, uint16_t reg, uint8_t reg_size,
+                 uint8_t *data, uint16_t len, I2CBus_Callback done, void *ctx) {
+    return submit(prio, addr, reg, reg_size, true, data, len, done, ctx);
+}
+
+bool I2CBus_Write(I2CPriority prio, uint8_t addr, uint16_t reg, uint8_t reg_size,
+                  const uint8_t *data, uint16_t len, I2CBus_Callback done, void *ctx) {
+    return submit(prio, addr, reg, reg_size, false, (uint8_t *)data, len, done, ctx);
+}
+
+/* ===== Blocking wrappers ===== */
+
+typedef struct {
+    volatile bool done;
+    HAL_StatusTypeDef status;
+} SyncResult;
+
+static void sync_done(void *ctx, HAL_StatusTypeDef status) {
+    SyncResult *result = ctx;
+    result->status = status;
+    result->done = true;
+}
+
+static HAL_StatusTypeDef sync_transfer(I2CPriority prio, uint8_t addr, uint16_t reg, uint8_t reg_size,
+                                       bool read, uint8_t *data, uint16_t len) {
+    SyncResult result = { false, HAL_OK };
+    while (!submit(prio, addr, reg, reg_size, read, data, len, sync_done, &result)) {}
+    while (!result.done) __WFI();
+    return result.status;
+}
+
+HAL_StatusTypeDef I2CBus_ReadSync(I2CPriority prio, uint8_t addr, uint16_t reg, uint8_t reg_size,
+                                  uint8_t *data, uint16_t len) {
+    return sync_transfer(prio, addr, reg, reg_size, true, data, len);
+}
+
+HAL_StatusTypeDef I2CBus_WriteSync(I2CPriority prio, uint8_t addr, uint16_t reg, uint8_t reg_size,
+                                   const uint8_t *data, uint16_t len) {
+    return sync_transfer(prio, addr, reg, reg_size, false, (uint8_t *)data, len);
+}
+
+/* ===== HAL completion callbacks ===== */
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)    { if (hi2c == bus) finish(HAL_OK); }
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)    { if (hi2c == bus) finish(HAL_OK); }
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c) { if (hi2c == bus) finish(HAL_OK); }
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c) { if (hi2c == bus) finish(HAL_OK); }
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)        { if (hi2c == bus) finish(HAL_ERROR); }
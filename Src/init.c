@@ -2,8 +2,11 @@
 
 /* Global handles */
 I2C_HandleTypeDef hi2c1;
+DMA_HandleTypeDef hdma_i2c1_tx;
 TIM_HandleTypeDef htim1;
 TIM_HandleTypeDef htim2;
+TIM_HandleTypeDef htim3;
+UART_HandleTypeDef huart1;
 
 /* Devices */
 VL6180X tofLeft, tofFront, tofRight;
@@ -41,33 +44,54 @@ static void VL6180X_InitializeAll(void) {
     VL6180X_InitOne(&tofLeft,  XSHUT_LEFT_PORT,  XSHUT_LEFT_PIN,  ADDR_LEFT);
     VL6180X_InitOne(&tofFront, XSHUT_FRONT_PORT, XSHUT_FRONT_PIN, ADDR_FRONT);
     VL6180X_InitOne(&tofRight, XSHUT_RIGHT_PORT, XSHUT_RIGHT_PIN, ADDR_RIGHT);
+
+    // Free-running ranging, staggered so the results (and bus reads) spread over the period
+    VL6180X_StartContinuous(&tofLeft, TOF_PERIOD_MS);
+    HAL_Delay(TOF_PERIOD_MS / 3);
+    VL6180X_StartContinuous(&tofFront, TOF_PERIOD_MS);
+    HAL_Delay(TOF_PERIOD_MS / 3);
+    VL6180X_StartContinuous(&tofRight, TOF_PERIOD_MS);
 }
 
 /* ------------------- System Init ------------------- */
 static void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
+static void MX_DMA_Init(void);
 static void MX_I2C1_Init(void);
 static void MX_TIM1_Init(void);
 static void MX_TIM2_Init(void);
+static void MX_TIM3_Init(void);
+static void MX_USART1_UART_Init(void);
 
 void System_Init(void) {
     HAL_Init();
     SystemClock_Config();
+    Timebase_Init();
     MX_GPIO_Init();
+    MX_DMA_Init();
     MX_I2C1_Init();
     MX_TIM1_Init();
     MX_TIM2_Init();
+    MX_TIM3_Init();
+    MX_USART1_UART_Init();
 
+    Params_Init();
+    I2CBus_Init(&hi2c1);
     ENCODER_Init();
     Buzzer_Init(&htim1);
     VL6180X_InitializeAll();
     MPU_Init(&hi2c1);
     DRV8833_Init(&motorL);
     DRV8833_Init(&motorR);
+    Telemetry_Init(&huart1);
+    Console_Init(&huart1);
 
     OLED_hi2c = &hi2c1;
     OLED_Init();
     OLED_Clear();
+
+    // Motion control tick runs from here on
+    HAL_TIM_Base_Start_IT(&htim3);
 }
 
 /*=========================== HAL Init Sections ============================*/
@@ -92,6 +116,13 @@ void SystemClock_Config(void) {
     if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_2) != HAL_OK) Error_Handler();
 }
 
+/* DMA1 channel 6 carries I2C1 TX (long display writes); linked in HAL_I2C_MspInit */
+static void MX_DMA_Init(void) {
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    HAL_NVIC_SetPriority(DMA1_Channel6_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Channel6_IRQn);
+}
+
 static void MX_I2C1_Init(void) {
     hi2c1.Instance             = I2C1;
     hi2c1.Init.ClockSpeed      = 400000;
@@ -150,6 +181,35 @@ static void MX_TIM2_Init(void) {
     HAL_TIM_MspPostInit(&htim2);
 }
 
+/* Motion control tick: 1 MHz counter, update event every LOOP_DT_MS */
+static void MX_TIM3_Init(void) {
+    TIM_ClockConfigTypeDef sClockSourceConfig = {0};
+
+    htim3.Instance               = TIM3;
+    htim3.Init.Prescaler         = 71;
+    htim3.Init.CounterMode       = TIM_COUNTERMODE_UP;
+    htim3.Init.Period            = LOOP_DT_MS * 1000 - 1;
+    htim3.Init.ClockDivision     = TIM_CLOCKDIVISION_DIV1;
+    htim3.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+    if (HAL_TIM_Base_Init(&htim3) != HAL_OK) Error_Handler();
+
+    sClockSourceConfig.ClockSource = TIM_CLOCKSOURCE_INTERNAL;
+    if (HAL_TIM_ConfigClockSource(&htim3, &sClockSourceConfig) != HAL_OK) Error_Handler();
+}
+
+/* Telemetry dump out, parameter console in */
+static void MX_USART1_UART_Init(void) {
+    huart1.Instance          = USART1;
+    huart1.Init.BaudRate     = TELEMETRY_BAUD;
+    huart1.Init.WordLength   = UART_WORDLENGTH_8B;
+    huart1.Init.StopBits     = UART_STOPBITS_1;
+    huart1.Init.Parity       = UART_PARITY_NONE;
+    huart1.Init.Mode         = UART_MODE_TX_RX;
+    huart1.Init.HwFlowCtl    = UART_HWCONTROL_NONE;
+    huart1.Init.OverSampling = UART_OVERSAMPLING_16;
+    if (HAL_UART_Init(&huart1) != HAL_OK) Error_Handler();
+}
+
 static void MX_GPIO_Init(void) {
     GPIO_InitTypeDef GPIO_InitStruct = {0};
 
@@ -173,18 +233,13 @@ static void MX_GPIO_Init(void) {
     GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
     HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 
-    GPIO_InitStruct.Pin  = GPIO_PIN_10 | GPIO_PIN_15;
-    GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
-    GPIO_InitStruct.Pull = GPIO_NOPULL;
-    HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
-
-    GPIO_InitStruct.Pin  = GPIO_PIN_11;
-    GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
+    GPIO_InitStruct.Pin  = GPIO_PIN_10 | GPIO_PIN_11 | GPIO_PIN_15;
+    GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING_FALLING;
     GPIO_InitStruct.Pull = GPIO_NOPULL;
     HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
 
     GPIO_InitStruct.Pin  = GPIO_PIN_8;
-    GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
+    GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING_FALLING;
     GPIO_InitStruct.Pull = GPIO_NOPULL;
     HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 
@@ -9,16 +9,29 @@
 #include "floodfill.h"
 #include "motion.h"
 #include "menu.h"
+#include "display.h"
+#include "perf.h"
+#include "telemetry.h"
+#include "params.h"
+#include "console.h"
 #include <stdbool.h>
 #include <stdlib.h>
 
 static bool started = false;
+static bool speedRun = false;  // The run is a speed run over the walls of the last search
 
 /*=========================== Helpers ==========================*/
 static inline bool btnPressed(GPIO_TypeDef* port, uint16_t pin) {
     return (HAL_GPIO_ReadPin(port, pin) == GPIO_PIN_RESET);
 }
 
+// Stops the robot and reports the run, however it ended
+static void endRun(void) {
+    started = false; speedRun = false; Motion_Abort(); Buzzer_Short();
+    Telemetry_Stop(); Telemetry_Dump();   // The last TELEMETRY_RECORDS records, out on the serial port
+    Display_PostProfile();  // Where the run's cycles went, until the next screen
+}
+
 static void waitConfirm(void) {
     HAL_Delay(50);
     while (btnPressed(BTN_CONFIRM_PORT, BTN_CONFIRM_PIN)) {}
@@ -29,7 +42,9 @@ int main(void) {
     System_Init();
 
     OLED_Print("Initializing", 2, 25);
+    OLED_Flush();
     Buzzer_Startup();
+    while (Buzzer_Busy()) __WFI();  // The gyro must calibrate without the buzzer shaking the board
     MPU_CalibrateGyroZ();
 
     OLED_Clear();
@@ -37,11 +52,23 @@ int main(void) {
     processMenu();
 
     int leftAccum = 0, rightAccum = 0;
+    int32_t leftLast = ENCODER_GetLeft(), rightLast = ENCODER_GetRight();
 
     while (1) {
-        int32_t leftCount = ENCODER_GetLeft();
+        // Keep the control tick fed; motion runs in the background
+        Motion_Service();
+
+        // The wheels double as menu knobs, but not while the robot drives
+        int32_t leftNow, rightNow;
+        ENCODER_Read(&leftNow, &rightNow);
+        bool knobs = !started && Motion_Idle();
+        int32_t leftCount = knobs ? leftNow - leftLast : 0;
+        int32_t rightCount = knobs ? rightNow - rightLast : 0;
+        leftLast = leftNow;
+        rightLast = rightNow;
+
         if (leftCount) {
-            leftAccum += leftCount; ENCODER_ResetLeft();
+            leftAccum += leftCount;
             if (abs(leftAccum) >= ENCODER_STEP) {
                 leftAccum = 0; Buzzer_Tick();
                 if (currentMenu == MENU_MAIN) {
@@ -51,16 +78,21 @@ int main(void) {
             }
         }
 
-        int32_t rightCount = ENCODER_GetRight();
         if (rightCount) {
-            rightAccum += rightCount; ENCODER_ResetRight();
+            rightAccum += rightCount;
             if (abs(rightAccum) >= ENCODER_STEP) {
                 rightAccum = 0; Buzzer_Tick();
                 switch (currentMenu) {
                     case MENU_SPEED: subIndex = (subIndex + (rightCount > 0 ? 1 : -1) + 2) % 2; selectedSpeedIndex = subIndex; break;
                     case MENU_TURN:  subIndex = (subIndex + (rightCount > 0 ? 1 : -1) + 3) % 3; selectedTurnIndex  = subIndex; break;
+                    case MENU_SEARCH: subIndex = (subIndex + (rightCount > 0 ? 1 : -1) + 2) % 2; selectedSearchIndex = subIndex; break;
                     case MENU_GOAL_X: goalX += (rightCount > 0 ? 1 : -1); break;
                     case MENU_GOAL_Y: goalY += (rightCount > 0 ? 1 : -1); break;
+                    case MENU_PARAM: subIndex = (subIndex + (rightCount > 0 ? 1 : -1) + PARAM_COUNT) % PARAM_COUNT; break;
+                    case MENU_PARAM_EDIT:
+                        Params_Set((ParamId)subIndex, Params_Get((ParamId)subIndex) +
+                                   (rightCount > 0 ? 1 : -1) * Params_Step((ParamId)subIndex));
+                        break;
                     default: break;
                 }
                 processMenu();
@@ -73,44 +105,80 @@ int main(void) {
                 if      (mainIndex == 0) { currentMenu = MENU_SPEED; subIndex = selectedSpeedIndex; }
                 else if (mainIndex == 1) { currentMenu = MENU_TURN;  subIndex = selectedTurnIndex; }
                 else if (mainIndex == 2) { currentMenu = MENU_GOAL_X; }
-                else if (mainIndex == 3) {
+                else if (mainIndex == 3) { currentMenu = MENU_SEARCH; subIndex = selectedSearchIndex; }
+                else if (mainIndex == 4) { currentMenu = MENU_PARAM; subIndex = 0; }
+                else if (mainIndex == 5 || mainIndex == 6) {
                     OLED_Clear(); Buzzer_Short();
                     OLED_Print("Wait for confirmation", 0, 0);
+                    OLED_Flush();
                     while (!started) {
                         uint8_t l = VL6180X_ReadAverage(&tofLeft, 3);
                         uint8_t r = VL6180X_ReadAverage(&tofRight, 3);
-                        if (l && r && l <= SENSOR_SIDE_LIMIT && r <= SENSOR_SIDE_LIMIT) {
+                        if (l && r && l <= Params_Int(PARAM_SIDE_LIMIT) && r <= Params_Int(PARAM_SIDE_LIMIT)) {
                             started = true;
+                            Perf_Reset();
+                            Telemetry_Start();
                             Buzzer_Confirm();
+                            Motion_SetTurnMode((TurnMode)selectedTurnIndex);
                             FloodFill_SetGoal(goalX, goalY);
+                            if (mainIndex == 6) {
+                                // Back at the start by hand: the whole route goes into the queue at once
+                                speedRun = true;
+                                FloodFill_ResetPose();
+                                FloodFill_RunBestPath(selectedTurnIndex == TURN_DIAGONAL);
+                                break;
+                            }
                             FloodFill_Init();
                             FloodFill_UpdateWalls(
-                                (VL6180X_ReadAverage(&tofFront, 3) <= SENSOR_FRONT_LIMIT),
-                                (VL6180X_ReadAverage(&tofRight, 3) <= SENSOR_FRONT_LIMIT),
-                                (VL6180X_ReadAverage(&tofLeft, 3)  <= SENSOR_FRONT_LIMIT));
+                                (VL6180X_ReadAverage(&tofFront, 3) <= Params_Int(PARAM_FRONT_LIMIT)),
+                                (VL6180X_ReadAverage(&tofRight, 3) <= Params_Int(PARAM_FRONT_LIMIT)),
+                                (VL6180X_ReadAverage(&tofLeft, 3)  <= Params_Int(PARAM_FRONT_LIMIT)));
                             FloodFill_Run();
                         }
                         if (btnPressed(BTN_BACK_PORT, BTN_BACK_PIN)){ break; }
                     }
                 }
             } else if (currentMenu == MENU_GOAL_X) currentMenu = MENU_GOAL_Y;
+            else if (currentMenu == MENU_PARAM) currentMenu = MENU_PARAM_EDIT;
+            else if (currentMenu == MENU_PARAM_EDIT) currentMenu = MENU_PARAM;
             else currentMenu = MENU_MAIN;
             Buzzer_Short(); processMenu();
         }
 
         if (btnPressed(BTN_BACK_PORT, BTN_BACK_PIN)) {
+            // Back during a run aborts it, with the usual report
+            if (started) endRun();
             HAL_Delay(50);
             while (btnPressed(BTN_BACK_PORT, BTN_BACK_PIN)) {}
+            // Leaving the parameter pages writes any change to flash
+            if (currentMenu == MENU_PARAM || currentMenu == MENU_PARAM_EDIT) Params_Save();
             if (currentMenu != MENU_MAIN) { currentMenu = MENU_MAIN; Buzzer_Short(); processMenu(); }
         }
 
-        if (started) {
+        // Plan the next cell once the previous move has finished, or in a
+        // continuous search while still rolling into the cell
+        bool ready = (selectedSearchIndex == 1) ? Motion_ApproachingEnd(SEARCH_DECIDE_TICKS) : Motion_Idle();
+        if (started && Motion_Stalled()) endRun();
+        if (started && speedRun) {
+            // Ends once the route is driven; a goal the known walls shut off queues nothing
+            if (Motion_Idle()) endRun();
+        } else if (started && ready) {
             FloodFill_UpdateWalls(
-                (VL6180X_ReadRange(&tofFront) <= SENSOR_FRONT_LIMIT),
-                (VL6180X_ReadRange(&tofRight) <= SENSOR_FRONT_LIMIT),
-                (VL6180X_ReadRange(&tofLeft)  <= SENSOR_FRONT_LIMIT));
-            FloodFill_Run(); FloodFill_MoveStep();
-            if (FloodFill_AtGoal()) { started = false; reset_motion(); Buzzer_Short(); }
+                (VL6180X_ReadRange(&tofFront) <= Params_Int(PARAM_FRONT_LIMIT)),
+                (VL6180X_ReadRange(&tofRight) <= Params_Int(PARAM_FRONT_LIMIT)),
+                (VL6180X_ReadRange(&tofLeft)  <= Params_Int(PARAM_FRONT_LIMIT)));
+            if (FloodFill_SearchDone()) {
+                Motion_Wait();
+                endRun();
+            } else {
+                FloodFill_MoveStep();
+            }
         }
+
+        // Serial parameter edits wait until the robot stands still
+        if (!started && Motion_Idle()) Console_Service();
+
+        // Screen updates wait for idle time or the refresh cap
+        Display_Service();
     }
 }
@@ -0,0 +1,120 @@
+#include "maze.h"
+#include <string.h>
+
+#define ROW_MASK ((uint16_t)((1u << W) - 1))
+
+// ===== Walls =====
+
+void Maze_Clear(MazeWalls *m) {
+    memset(m, 0, sizeof(*m));
+}
+
+bool Maze_HasWall(const MazeWalls *m, int x, int y, Direction d) {
+    switch (d) {
+        case North: return (y >= H - 1) || (m->north[y] >> x & 1);
+        case East:  return (x >= W - 1) || (m->east[y] >> x & 1);
+        case South: return (y <= 0)     || (m->north[y - 1] >> x & 1);
+        case West:  return (x <= 0)     || (m->east[y] >> (x - 1) & 1);
+    }
+    return true;
+}
+
+bool Maze_IsKnown(const MazeWalls *m, int x, int y, Direction d) {
+    switch (d) {
+        case North: return (y >= H - 1) || (m->knownNorth[y] >> x & 1);
+        case East:  return (x >= W - 1) || (m->knownEast[y] >> x & 1);
+        case South: return (y <= 0)     || (m->knownNorth[y - 1] >> x & 1);
+        case West:  return (x <= 0)     || (m->knownEast[y] >> (x - 1) & 1);
+    }
+    return true;
+}
+
+bool Maze_SetWall(MazeWalls *m, int x, int y, Direction d, bool wall) {
+    uint16_t *row, *known;
+    int bit;
+
+    // Map every side onto its single stored (north/east) bit
+    switch (d) {
+        case North: row = &m->north[y];     known = &m->knownNorth[y];     bit = x;     break;
+        case East:  row = &m->east[y];      known = &m->knownEast[y];      bit = x;     break;
+        case South: if (y <= 0) return false;
+                    row = &m->north[y - 1]; known = &m->knownNorth[y - 1]; bit = x;     break;
+        case West:  if (x <= 0) return false;
+                    row = &m->east[y];      known = &m->knownEast[y];      bit = x - 1; break;
+        default:    return false;
+    }
+
+    uint16_t mask = (uint16_t)(1u << bit);
+    *known |= mask;
+    uint16_t updated = wall ? (*row | mask) : (*row & ~mask);
+    if (updated == *row) return false;
+    *row = updated;
+    return true;
+}
+
+// ===== Flood =====
+
+static void stampRow(uint8_t dist[W][H], int y, uint16_t bits, uint8_t d) {
+    while (bits) {
+        int xb = __builtin_ctz(bits);
+        dist[xb][y] = d;
+        bits &= bits - 1;
+    }
+}
+
+void Maze_Flood(const MazeWalls *m, const uint16_t seed[H], bool unknownIsWall, uint8_t dist[W][H]) {
+    uint16_t frontier[H], visited[H], next[H];
+    uint16_t north[H], east[H];
+    int lo = H, hi = -1;
+
+    for (int y = 0; y < H; y++) {
+        north[y] = m->north[y];
+        east[y] = m->east[y];
+        if (unknownIsWall) {
+            north[y] |= (uint16_t)~m->knownNorth[y];
+            east[y] |= (uint16_t)~m->knownEast[y];
+        }
+    }
+
+    memset(dist, 255, sizeof(uint8_t) * W * H);
+
+    for (int y = 0; y < H; y++) {
+        frontier[y] = visited[y] = seed[y] & ROW_MASK;
+        if (frontier[y]) {
+            if (y < lo) lo = y;
+            hi = y;
+        }
+    }
+
+    uint8_t d = 0;
+    while (lo <= hi) {
+        for (int y = lo; y <= hi; y++) stampRow(dist, y, frontier[y], d);
+        d++;
+
+        // The next layer can only reach one row beyond the current one
+        int nlo = (lo > 0) ? lo - 1 : 0;
+        int nhi = (hi < H - 1) ? hi + 1 : H - 1;
+        int newLo = H, newHi = -1;
+
+        for (int y = nlo; y <= nhi; y++) {
+            uint16_t f = frontier[y];
+            uint16_t n = (uint16_t)((f & ~east[y]) << 1) | ((f >> 1) & ~east[y]);
+            if (y > 0)     n |= frontier[y - 1] & ~north[y - 1];
+            if (y < H - 1) n |= frontier[y + 1] & ~north[y];
+            n &= ~visited[y] & ROW_MASK;
+            next[y] = n;
+            if (n) {
+                if (y < newLo) newLo = y;
+                newHi = y;
+            }
+        }
+
+        for (int y = lo; y <= hi; y++) frontier[y] = 0;
+        for (int y = nlo; y <= nhi; y++) {
+            frontier[y] = next[y];
+            visited[y] |= next[y];
+        }
+        lo = newLo;
+        hi = newHi;
+    }
+}
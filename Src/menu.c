@@ -4,6 +4,7 @@
 /* Global menu variables */
 int selectedSpeedIndex = 0;
 int selectedTurnIndex  = 0;
+int selectedSearchIndex = 0;
 int goalX = 0, goalY = 0;
 MenuState currentMenu = MENU_MAIN;
 int mainIndex = 0;
@@ -12,6 +13,7 @@ int subIndex  = 0;
 /* Menu option labels */
 static const char * const speedOptions[] = { "Medium", "Fast" };
 static const char * const turnOptions[]  = { "Pivot", "Curve", "Diagonal" };
+static const char * const searchOptions[] = { "Stop", "Flow" };
 
 void processMenu(void) {
     OLED_Clear();
@@ -29,7 +31,11 @@ void processMenu(void) {
                 OLED_Print("Goal:", 2, 0);
                 OLED_Print(buf, 3, 0);
             } break;
-            case 3: OLED_Print("Start", 2, 0); break;
+            case 3: OLED_Print("Search:", 2, 0);
+                    OLED_Print((char*)searchOptions[selectedSearchIndex], 3, 0); break;
+            case 4: OLED_Print("Params", 2, 0); break;
+            case 5: OLED_Print("Start", 2, 0); break;
+            case 6: OLED_Print("Speed Run", 2, 0); break;
             default: mainIndex = 0; break;
         }
         return;
@@ -38,9 +44,21 @@ void processMenu(void) {
     const char *title = NULL, *value = NULL;
     char buf[12];
 
+    if (currentMenu == MENU_PARAM || currentMenu == MENU_PARAM_EDIT) {
+        char line[22];
+        Params_Format(Params_Get((ParamId)subIndex), buf, sizeof(buf));
+        snprintf(line, sizeof(line), "%s%s", currentMenu == MENU_PARAM_EDIT ? "> " : "", buf);
+        OLED_Print(currentMenu == MENU_PARAM ? "Params" : "Set Param", 0, 0);
+        OLED_Print((char*)Params_Name((ParamId)subIndex), 2, 0);
+        OLED_Print(line, 3, 0);
+        if (Params_Dirty()) OLED_Print("Back saves", 1, 0);
+        return;
+    }
+
     switch (currentMenu) {
         case MENU_SPEED: title = "Set Speed"; value = speedOptions[subIndex]; break;
         case MENU_TURN:  title = "Set Turn";  value = turnOptions[subIndex]; break;
+        case MENU_SEARCH: title = "Set Search"; value = searchOptions[subIndex]; break;
         case MENU_GOAL_X: title = "Set Goal X"; snprintf(buf, sizeof(buf), "%d", goalX); value = buf; break;
         case MENU_GOAL_Y: title = "Set Goal Y"; snprintf(buf, sizeof(buf), "%d", goalY); value = buf; break;
         default: return;
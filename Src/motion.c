@@ -3,16 +3,21 @@
 #include "vl6180x.h"
 #include "drv8833.h"
 #include "MPU.h"
+#include "buzzer.h"
+#include "timebase.h"
+#include "perf.h"
+#include "telemetry.h"
+#include "params.h"
+#include "profile.h"
+#include "fixmath.h"
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 /* ==================== Configuration Constants ==================== */
-#define MOTOR_R_GAIN        1.10f   // Right motor gain for symmetry
-#define MIN_FWD_SPEED       140     // Minimum forward speed
+/* Gains, speeds and calibration live in the parameter table (params.h) */
+#define MIN_FWD_SPEED       200.0f  // Minimum forward cruise speed (mm/s)
 #define TOF_ALPHA           0.5f    // Low-pass filter smoothing for ToF (0..1)
-#define KP_SIDE             1.0f    // Proportional gain for side difference (mm)
-#define KD_SIDE             3.0f    // Derivative gain for side difference (mm/loop)
-#define KENC                1.0f    // Encoder balance gain (ticks)
 #define E_BAD_THRESH        12.0f   // Large lateral error threshold (mm)
 #define DE_BAD_THRESH       20.0f   // Large angle rate threshold (mm/loop)
 #define CENTER_MM_DEFAULT   100.0f  // Default single-wall target distance (mm)
@@ -20,298 +25,975 @@
 #define FRONT_WALL_THRESH   80.0f   // Front wall distance threshold (mm)
 #define CORNER_THRESH       20.0f   // Sudden distance drop for corner detection (mm)
 #define DE_MAX              15.0f   // Max derivative to limit twitchiness (mm/loop)
+#define FRONT_STOP_ARM_MM   40.0f   // Travel before a front wall may end a straight (mm)
+#define FRONT_STOP_PIVOT    90      // Front reading at the cell centre, where a pivot turns (mm)
+#define FRONT_STOP_CURVE    150     // Front reading where a curve into the side cell begins (mm)
 
 /* ==================== Configuration for Curve Turn ==================== */
-#define KP_YAW              15.0f    // Proportional gain for yaw control
-#define BASE_CURVE_SPEED    200     // Base speed for outer wheel during curve
-#define MIN_CURVE_SPEED     50      // Minimum speed for inner wheel
+#define MIN_CURVE_SPEED     100.0f   // Minimum inner wheel speed (mm/s)
+#define MIN_PIVOT_SPEED     80.0f    // Slowest pivot wheel speed (mm/s)
 #define YAW_TOLERANCE       0.5f    // Yaw error tolerance for completion (degrees)
+#define CURVE_EXIT_MM       50      // A curve ends this far past the centre of the new cell (mm)
+
+/* ==================== Configuration for Diagonals ==================== */
+#define DIAG_SEG_RATIO      0.7071f // Diagonal segment length (edge to edge) per cell
+#define DIAG_INNER_45       0.45f   // Inner/outer wheel ratio for 45 degree turns
+#define DIAG_INNER_135      0.15f   // Inner/outer wheel ratio for 135 degree turns
+#define DIAG_TAN_45         0.4142f // tan(22.5): corner to arc end per mm of turn radius
+#define DIAG_TAN_135        2.4142f // tan(67.5)
+#define DIAG_STEER_PER_MM   1.0f    // Heading offset (deg) per mm off a diagonal's line
+#define DIAG_STEER_MAX      15.0f   // Cap on that offset (deg)
+#define HEADING_FIX_MM      120.0f  // Travel between two walls that squares up the heading (mm)
+#define HEADING_FIX_GAIN    0.5f    // Share of the measured heading error taken out each time
+#define HEADING_FIX_MAX     2.0f    // Cap on one correction (deg)
+
+/* ==================== Configuration for Wheel Speed ==================== */
+#define WHEEL_ACCEL_LIMIT   8000.0f // Clamp on the feedforward acceleration (mm/s^2)
+#define VEL_WINDOW          8       // Control ticks averaged for the speed estimate, power of two
 
 /* ==================== Helper Functions ==================== */
 static inline int clamp_int(int value, int min, int max) {
     return (value < min) ? min : (value > max) ? max : value;
 }
 
-static inline float clamp_float(float value, float min, float max) {
-    return (value < min) ? min : (value > max) ? max : value;
+static inline real_t get_base_speed(void) {
+    extern int selectedSpeedIndex; // Defined in main.c
+    return Params_Real(selectedSpeedIndex == 0 ? PARAM_SPEED_MEDIUM : PARAM_SPEED_FAST);
 }
 
-static inline int get_base_speed(void) {
-    extern int selectedSpeedIndex; // Defined in main.c
-    return (selectedSpeedIndex == 0) ? SPEED_MEDIUM : SPEED_FAST;
+static inline int get_ticks_per_cell(void) {
+    extern int selectedSpeedIndex;
+    int ticks = Params_Int(PARAM_TICKS_PER_CELL);
+    if (selectedSpeedIndex == 1) {
+        return (ticks - TICK_FAST) < 0 ? 0 : (ticks - TICK_FAST);
+    }
+    return ticks;
+}
+
+static inline real_t wrap_deg(real_t deg) {
+    if (deg > REAL(180)) deg -= REAL(360);
+    if (deg < REAL(-180)) deg += REAL(360);
+    return deg;
 }
 
 static inline bool is_tof_valid(uint8_t distance) {
-    return (distance > 0) && (distance <= SENSOR_FRONT_LIMIT);
+    return (distance > 0) && (distance <= Params_Int(PARAM_FRONT_LIMIT));
+}
+
+/* ==================== Command Queue ==================== */
+typedef enum {
+    CMD_STRAIGHT,       // ticks, centering on ToF side walls
+    CMD_DIAGONAL,       // ticks, holding gyro heading
+    CMD_PIVOT,          // deg, positive = left
+    CMD_CURVE,          // deg, positive = left
+    CMD_DIAG_TURN       // deg, positive = left
+} MotionCmdType;
+
+typedef struct {
+    uint8_t type;       // MotionCmdType
+    int32_t ticks;
+    real_t deg;
+} MotionCmd;
+
+#define MOTION_QUEUE_LEN    32      // Must be a power of two
+
+static MotionCmd cmd_queue[MOTION_QUEUE_LEN];
+static volatile uint8_t cmd_head;   // Next command to start (control tick side)
+static volatile uint8_t cmd_tail;   // Next free slot (thread side)
+static volatile bool cmd_active;
+static volatile uint8_t active_type;
+static volatile bool stalled;
+static uint16_t stall_ticks;
+static TurnMode turn_mode;
+
+/* Latest sensor values, published from thread context by Motion_Service() */
+typedef struct {
+    uint32_t tof_seq;   // Bumped whenever the ToF values are refreshed
+    uint32_t tof_us;    // Timebase_Us() of the newer side reading
+    uint8_t left, right, front;
+    real_t yaw;
+} SensorSnapshot;
+
+static SensorSnapshot snapshot;
+static volatile uint32_t snapshot_seq;  // Odd while the snapshot is being written
+static SensorSnapshot sensors;          // Control tick's copy
+
+/* ==================== Control State ==================== */
+static struct {
+    MotionCmd cmd;
+    int direction;
+    real_t desired_yaw;
+    real_t heading;                 // Yaw of the maze direction the robot faces, carried through turns
+    bool heading_set;               // heading holds: the queue has not run dry since it was taken
+    real_t along_mm, cross_mm;      // Odometry from the last waypoint, along heading and to its left
+    real_t line_mm;                 // Length of the straight or diagonal being driven, from that waypoint
+    int32_t odo_ticks;              // Travel already added to the odometry
+    int expected_ticks;
+    real_t inner_ratio;
+    int32_t front_arm_ticks;        // Travel before a front wall may end a straight
+    bool front_stopped;             // The last straight ended on its front wall
+    uint8_t prev_type;              // MotionCmdType of the command before this one
+    int32_t ahead_mm;               // How far past the cell centre (or diagonal waypoint) the robot stands, along its heading
+
+    // Straight-line filter state, advanced once per new ToF sample
+    uint32_t tof_seq;
+    uint32_t tof_us;
+    real_t left_filtered, right_filtered;
+    real_t left_prev_raw, right_prev_raw;
+    real_t center_mm;
+    real_t prev_error;
+    bool is_initialized;
+    bool fix_run;                   // The last ToF sample placed the robot between two walls
+    real_t fix_along_mm;            // Where this run of wall fixes began
+    real_t fix_drift_mm;            // Sideways odometry the walls have taken back since
+    real_t forward_speed;
+    real_t side_correction;
+
+    // Forward speed profile; velocity carries over between queued segments
+    Profile profile;
+    real_t velocity;
+} ctl;
+
+/* ==================== Wheel Speed Control ==================== */
+typedef struct {
+    int32_t last_count;
+    int16_t deltas[VEL_WINDOW];     // Encoder ticks per control tick, newest at idx - 1
+    uint32_t stamps[VEL_WINDOW];    // Timebase_Us() of the reading before each delta
+    int32_t delta_sum;
+    uint8_t idx;
+    real_t speed;                   // Measured, mm/s
+    real_t target;                  // Commanded, mm/s
+    real_t prev_target;
+    real_t integral;
+    real_t prev_error;
+} Wheel;
+
+static Wheel wheelL, wheelR;
+static bool wheels_enabled;         // False while braked: PWM is left alone
+static int16_t pwm_left, pwm_right; // Last duty sent while enabled
+
+// Encoder counts run free; moves measure travel from the counts at their start
+static int32_t enc_left, enc_right;         // Read once per control tick
+static uint32_t enc_us;                     // Timebase_Us() of that reading
+static int32_t enc_base_l, enc_base_r;
+static real_t mm_per_tick;                  // From the tick_cell parameter as each command starts
+
+static inline int32_t left_ticks(void)  { return enc_left - enc_base_l; }
+static inline int32_t right_ticks(void) { return enc_right - enc_base_r; }
+
+static void wheel_clear(Wheel *w, int32_t count, uint32_t now_us) {
+    memset(w, 0, sizeof(*w));
+    w->last_count = count;
+    // Pretend the empty window was sampled on schedule
+    for (int i = 0; i < VEL_WINDOW; i++) w->stamps[i] = now_us - (uint32_t)(VEL_WINDOW - i) * LOOP_DT_MS * 1000;
+}
+
+/* Speed from the encoder ticks seen over the last VEL_WINDOW control ticks,
+   divided by the time those readings really spanned (interrupt latency varies) */
+static void wheel_measure(Wheel *w, int32_t count, uint32_t now_us) {
+    int32_t delta = count - w->last_count;
+    w->last_count = count;
+    w->delta_sum += delta - w->deltas[w->idx];
+    w->deltas[w->idx] = (int16_t)delta;
+
+    uint32_t span_us = now_us - w->stamps[w->idx];
+    w->stamps[w->idx] = now_us;
+    w->idx = (w->idx + 1) & (VEL_WINDOW - 1);
+
+    if (span_us == 0) return;
+    w->speed = r_scale(r_mul(r_int(w->delta_sum), mm_per_tick), 1000000, (int32_t)span_us);
+}
+
+/**
+ * Motor model feedforward (static friction, speed and acceleration terms) plus a
+ * PID on the measured speed, which absorbs battery sag, friction and motor mismatch.
+ */
+static int wheel_output(Wheel *w) {
+    const int rate = 1000 / LOOP_DT_MS;
+    const real_t max_step = REAL(WHEEL_ACCEL_LIMIT * LOOP_DT_MS / 1000.0f);
+
+    // Clamp the per-tick change before scaling it to mm/s^2, keeping it in range
+    real_t accel = r_clamp(w->target - w->prev_target, -max_step, max_step) * rate;
+    w->prev_target = w->target;
+
+    real_t out = r_mul(Params_Real(PARAM_KV_WHEEL), w->target) + r_mul(Params_Real(PARAM_KA_WHEEL), accel);
+    if (w->target > 0) out += Params_Real(PARAM_KS_WHEEL);
+    else if (w->target < 0) out -= Params_Real(PARAM_KS_WHEEL);
+
+    real_t error = w->target - w->speed;
+    out += r_mul(Params_Real(PARAM_KP_WHEEL), error) + r_mul(Params_Real(PARAM_KI_WHEEL), w->integral) +
+           r_mul(Params_Real(PARAM_KD_WHEEL) * rate, error - w->prev_error);
+    w->prev_error = error;
+
+    // Stop integrating while the output is pinned in the direction of the error
+    if ((out < r_int(SPEED_MAX) || error < 0) && (out > r_int(SPEED_MIN) || error > 0)) {
+        w->integral += error / rate;
+    }
+    return clamp_int(r_toint(out), SPEED_MIN, SPEED_MAX);
 }
 
-static inline float low_pass_filter(float previous, float current, float alpha) {
-    return previous + alpha * (current - previous);
+/* Wheel speed targets in mm/s, tracked from the next control tick on */
+static void set_wheel_speeds(real_t left, real_t right) {
+    if (!wheels_enabled) {
+        wheel_clear(&wheelL, enc_left, enc_us);
+        wheel_clear(&wheelR, enc_right, enc_us);
+        wheels_enabled = true;
+    }
+    wheelL.target = left;
+    wheelR.target = right;
+}
+
+/* Zero the travel of the current move; the encoder counts themselves keep running */
+static void reset_encoders(void) {
+    ENCODER_Read(&enc_base_l, &enc_base_r);
 }
 
 /* ==================== Motion Control Functions ==================== */
 void reset_motion(void) {
+    wheels_enabled = false;
     DRV8833_Brake(&motorL);
     DRV8833_Brake(&motorR);
     DRV8833_SetSpeed(&motorL, 0);
     DRV8833_SetSpeed(&motorR, 0);
-    ENCODER_ResetLeft();
-    ENCODER_ResetRight();
+    reset_encoders();
+    ctl.velocity = 0;
+}
+
+/**
+ * Speed the robot may carry into the next queued command: full speed into another
+ * straight, curve speed into a moving turn, and a stop before a pivot or an empty queue.
+ */
+static real_t exit_speed(real_t cruise) {
+    if (cmd_head == cmd_tail) return 0;
+    switch (cmd_queue[cmd_head & (MOTION_QUEUE_LEN - 1)].type) {
+        case CMD_STRAIGHT:
+        case CMD_DIAGONAL:  return cruise;
+        case CMD_CURVE:
+        case CMD_DIAG_TURN: return Params_Real(PARAM_CURVE_SPEED);
+        default:            return 0;
+    }
+}
+
+/**
+ * A moving diagonal turn is an arc, not a corner: it starts this far (mm) before
+ * the waypoint where its two lines meet and ends as far past it. The radius follows
+ * from the wheel ratio, floored by MIN_CURVE_SPEED as in the turn itself, and the
+ * half track, which the pivot calibration gives: a quarter turn rolls each wheel
+ * pi/2 half tracks.
+ */
+static real_t diag_lead_mm(real_t deg) {
+    bool wide = r_abs(deg) > REAL(90);
+    real_t outer = Params_Real(PARAM_CURVE_SPEED);
+    real_t ratio = r_max(wide ? REAL(DIAG_INNER_135) : REAL(DIAG_INNER_45), r_div(REAL(MIN_CURVE_SPEED), outer));
+    real_t half_track = r_div(r_mul(Params_Real(PARAM_TICKS_PER_TURN), mm_per_tick), REAL(1.5708f));
+    real_t radius = r_muldiv(half_track, REAL_ONE + ratio, REAL_ONE - ratio);
+    return r_mul(radius, wide ? REAL(DIAG_TAN_135) : REAL(DIAG_TAN_45));
+}
+
+static const MotionCmd *next_diag_turn(void) {
+    if (cmd_head == cmd_tail) return NULL;
+    const MotionCmd *next = &cmd_queue[cmd_head & (MOTION_QUEUE_LEN - 1)];
+    return (next->type == CMD_DIAG_TURN) ? next : NULL;
+}
+
+/* Ticks a straight or diagonal leaves off its end for a diagonal turn queued behind
+   it. A speed run queues its moves well ahead, so the turn is there when it starts */
+static int32_t lead_in_ticks(void) {
+    const MotionCmd *next = next_diag_turn();
+    return next ? r_toint(r_div(diag_lead_mm(next->deg), mm_per_tick)) : 0;
+}
+
+/* Ticks a line ends early by to start its diagonal turn offset_mm right of it: the
+   turn moves along the line as far as the robot stands off it, which puts the next
+   line back through the waypoint. Negative: ends late */
+static int32_t offset_shift_ticks(real_t offset_mm) {
+    const MotionCmd *next = next_diag_turn();
+    if (!next) return 0;
+    real_t shift = (next->deg > 0) ? offset_mm : -offset_mm;            // Outside of a 45
+    if (r_abs(next->deg) > REAL(90)) shift = -shift;                    // A 135 folds back across the line
+    return r_toint(r_div(shift, mm_per_tick));
+}
+
+/* Dead reckoning relative to the line the robot follows, for the diagonal moves:
+   nothing else places the robot there, and two side walls only do it sideways */
+static void odometry_step(int avg_count) {
+    real_t travel = r_mul(r_int(avg_count - ctl.odo_ticks), mm_per_tick);
+    real_t angle = wrap_deg(sensors.yaw - ctl.heading);
+    ctl.odo_ticks = avg_count;
+    ctl.along_mm += r_mul(travel, r_cos_deg(angle));
+    ctl.cross_mm += r_mul(travel, r_sin_deg(angle));
+}
+
+/* Advances the forward profile one tick; the next command is re-checked every tick
+   because the thread may queue it while this segment is already running */
+static real_t profile_step(real_t cruise, int travelled) {
+    ctl.profile.v_max = cruise;
+    ctl.profile.v_end = r_min(exit_speed(cruise), cruise);
+    ctl.velocity = Profile_Step(&ctl.profile, r_mul(r_int(travelled), mm_per_tick), 1000 / LOOP_DT_MS);
+    return ctl.velocity;
 }
 
 /**
- * Drives forward for a specified number of cells, centering between walls using ToF sensors.
+ * Drives forward for cmd.ticks encoder ticks, centering between walls using ToF sensors.
  * Fuses lateral error (left-right distance) with its derivative and encoder balance.
  * Realigns when a front wall is detected and mitigates twitchiness at corners.
+ * Speed follows the forward profile, entering and leaving at the speeds of its neighbours.
  */
-void driveForward(int cells) {
-    if (cells <= 0) return;
+static void straight_start(void) {
+    reset_encoders();
 
-    // Adjust ticks per cell based on speed profile
-    int ticks_per_cell = TICKS_PER_CELL;
-    extern int selectedSpeedIndex;
-    if (selectedSpeedIndex == 1) {
-        ticks_per_cell = (TICKS_PER_CELL - TICK_FAST) < 0 ? 0 : (TICKS_PER_CELL - TICK_FAST);
+    // Initialize filter states
+    ctl.left_filtered = 0;
+    ctl.right_filtered = 0;
+    ctl.left_prev_raw = 0;
+    ctl.right_prev_raw = 0;
+    ctl.center_mm = REAL(CENTER_MM_DEFAULT);
+    ctl.prev_error = 0;
+    ctl.is_initialized = false;
+    ctl.fix_run = false;
+    ctl.tof_seq = sensors.tof_seq - 1;  // Use the latest sample on the first tick
+    ctl.tof_us = sensors.tof_us - TOF_PERIOD_MS * 1000;
+    ctl.forward_speed = get_base_speed();
+    ctl.side_correction = 0;
+    ctl.odo_ticks = 0;
+    ctl.line_mm = r_mul(r_int(ctl.cmd.ticks), mm_per_tick);
+    if (ctl.prev_type != CMD_DIAG_TURN) {
+        ctl.along_mm = r_int(ctl.ahead_mm);
+        ctl.cross_mm = 0;
     }
 
-    const int target_ticks = ticks_per_cell * cells;
-    const int base_speed = get_base_speed();
+    // End on the cell centre even if the last turn left the robot off it
+    ctl.cmd.ticks -= r_toint(r_div(r_int(ctl.ahead_mm), mm_per_tick)) + lead_in_ticks();
+    ctl.ahead_mm = 0;
+    ctl.front_arm_ticks = r_toint(r_div(REAL(FRONT_STOP_ARM_MM), mm_per_tick));
+    ctl.front_stopped = false;
 
-    ENCODER_ResetLeft();
-    ENCODER_ResetRight();
+    Profile_Start(&ctl.profile, r_mul(r_int(ctl.cmd.ticks), mm_per_tick), ctl.velocity,
+                  ctl.forward_speed, exit_speed(ctl.forward_speed));
+}
 
-    // Initialize filter states
-    float left_filtered = 0.0f, right_filtered = 0.0f;
-    float left_prev_raw = 0.0f, right_prev_raw = 0.0f;
-    float center_mm = CENTER_MM_DEFAULT;
-    float prev_error = 0.0f;
-    bool is_initialized = false;
-
-    uint32_t last_update = HAL_GetTick();
-    uint32_t turn_cooldown_end = HAL_GetTick() + 500;
-
-    while (true) {
-        if (HAL_GetTick() - last_update < LOOP_DT_MS) continue;
-        last_update = HAL_GetTick();
-
-        // Read encoder counts
-        int left_count = ENCODER_GetLeft();
-        int right_count = ENCODER_GetRight();
-        int avg_count = (left_count + right_count) / 2;
-
-        // Read ToF sensors
-        uint8_t left_raw = VL6180X_ReadRange(&tofLeft);
-        uint8_t right_raw = VL6180X_ReadRange(&tofRight);
-        uint8_t front_raw = VL6180X_ReadRange(&tofFront);
-        bool left_valid = is_tof_valid(left_raw);
-        bool right_valid = is_tof_valid(right_raw);
-        bool front_valid = is_tof_valid(front_raw) && front_raw <= FRONT_WALL_THRESH;
-
-        // Detect corners (sudden distance changes)
-        bool is_corner = false;
-        if (left_valid && is_initialized && fabsf((float)left_raw - left_prev_raw) > CORNER_THRESH) {
-            is_corner = true;
-        }
-        if (right_valid && is_initialized && fabsf((float)right_raw - right_prev_raw) > CORNER_THRESH) {
-            is_corner = true;
-        }
-        left_prev_raw = left_valid ? (float)left_raw : left_prev_raw;
-        right_prev_raw = right_valid ? (float)right_raw : right_prev_raw;
-
-        // Low-pass filter ToF readings
-        if (!is_initialized) {
-            if (left_valid) left_filtered = left_raw;
-            if (right_valid) right_filtered = right_raw;
-            is_initialized = true;
-        } else {
-            if (left_valid) left_filtered = low_pass_filter(left_filtered, (float)left_raw, is_corner ? 0.2f : TOF_ALPHA);
-            if (right_valid) right_filtered = low_pass_filter(right_filtered, (float)right_raw, is_corner ? 0.2f : TOF_ALPHA);
+/* Two side walls place the robot across the corridor. What odometry drifted
+   from that, steadily over a run of such fixes, is the heading being off the
+   maze: the hand placing the robot, or gyro drift. The diagonals have no walls
+   to hold them and steer by that heading alone */
+static void wall_fix(real_t cross_mm) {
+    if (!ctl.fix_run) {
+        ctl.fix_run = true;
+        ctl.fix_along_mm = ctl.along_mm;
+        ctl.fix_drift_mm = 0;
+    } else {
+        ctl.fix_drift_mm += ctl.cross_mm - cross_mm;
+        real_t travel = ctl.along_mm - ctl.fix_along_mm;
+        if (travel >= REAL(HEADING_FIX_MM)) {
+            real_t deg = r_mul(r_div(ctl.fix_drift_mm, travel), REAL(57.2958f * HEADING_FIX_GAIN));
+            ctl.heading = wrap_deg(ctl.heading + r_clamp(deg, REAL(-HEADING_FIX_MAX), REAL(HEADING_FIX_MAX)));
+            ctl.fix_along_mm = ctl.along_mm;
+            ctl.fix_drift_mm = 0;
         }
+    }
+    ctl.cross_mm = cross_mm;
+}
 
-        // Calculate centering error
-        float error = 0.0f;
-        bool have_both_sides = left_valid && right_valid;
-        if (front_valid && (left_valid || right_valid)) {
-            error = left_valid ? (left_filtered - center_mm) : (center_mm - right_filtered);
-        } else if (have_both_sides) {
-            error = left_filtered - right_filtered;
-            center_mm = low_pass_filter(center_mm, (left_filtered + right_filtered) * 0.5f, CENTER_ALPHA);
-        } else if (left_valid) {
-            error = left_filtered - center_mm;
-        } else if (right_valid) {
-            error = center_mm - right_filtered;
-        }
+static void straight_update_tof(void) {
+    const real_t base_speed = get_base_speed();
 
-        float error_derivative = clamp_float(error - prev_error, -DE_MAX, DE_MAX);
-        prev_error = error;
-
-        // Adjust forward speed
-        int forward_speed = base_speed;
-        float slow_scale = 1.0f;
-        if (is_corner || (front_valid && (left_valid || right_valid))) {
-            slow_scale = 0.5f;
-        } else if (fabsf(error) > E_BAD_THRESH || fabsf(error_derivative) > DE_BAD_THRESH) {
-            slow_scale = 0.55f;
-        } else if (have_both_sides) {
-            slow_scale = 0.85f + 0.15f * (1.0f - clamp_float(fabsf(error) / E_BAD_THRESH, 0.0f, 1.0f));
-        }
-        forward_speed = (int)(forward_speed * slow_scale);
-        if (forward_speed < MIN_FWD_SPEED) forward_speed = MIN_FWD_SPEED;
-
-        // Apply steering correction
-        float kp = is_corner ? (KP_SIDE * 0.5f) : KP_SIDE;
-        float kd = is_corner ? (KD_SIDE * 0.5f) : KD_SIDE;
-        float enc_correction = KENC * (float)(left_count - right_count);
-        float side_correction = (left_valid || right_valid) ? (kp * error + kd * error_derivative) : 0.0f;
-        float correction = enc_correction + side_correction;
-
-        int left_cmd = clamp_int((int)(forward_speed - correction), SPEED_MIN, SPEED_MAX);
-        int right_cmd = clamp_int((int)((forward_speed + correction) * MOTOR_R_GAIN), SPEED_MIN, SPEED_MAX);
-
-        DRV8833_SetSpeed(&motorL, left_cmd);
-        DRV8833_SetSpeed(&motorR, right_cmd);
-
-        // Check stop conditions
-        extern int selectedTurnIndex;
-        if (avg_count >= target_ticks) {
-            //reset_motion();
-            break;
-        }
+    uint8_t left_raw = sensors.left;
+    uint8_t right_raw = sensors.right;
+    uint8_t front_raw = sensors.front;
+    bool left_valid = is_tof_valid(left_raw);
+    bool right_valid = is_tof_valid(right_raw);
+    bool front_valid = is_tof_valid(front_raw) && front_raw <= FRONT_WALL_THRESH;
+
+    // A side not seen yet this straight has no filter to blend into
+    bool left_first = left_valid && ctl.left_prev_raw == 0;
+    bool right_first = right_valid && ctl.right_prev_raw == 0;
+
+    // Detect corners (sudden distance changes)
+    bool is_corner = false;
+    if (left_valid && ctl.is_initialized && r_abs(r_int(left_raw) - ctl.left_prev_raw) > REAL(CORNER_THRESH)) {
+        is_corner = true;
+    }
+    if (right_valid && ctl.is_initialized && r_abs(r_int(right_raw) - ctl.right_prev_raw) > REAL(CORNER_THRESH)) {
+        is_corner = true;
+    }
+    ctl.left_prev_raw = left_valid ? r_int(left_raw) : ctl.left_prev_raw;
+    ctl.right_prev_raw = right_valid ? r_int(right_raw) : ctl.right_prev_raw;
+
+    // Low-pass filter ToF readings
+    real_t alpha = is_corner ? REAL(0.2f) : REAL(TOF_ALPHA);
+    if (left_first) ctl.left_filtered = r_int(left_raw);
+    else if (left_valid) ctl.left_filtered = r_lpf(ctl.left_filtered, r_int(left_raw), alpha);
+    if (right_first) ctl.right_filtered = r_int(right_raw);
+    else if (right_valid) ctl.right_filtered = r_lpf(ctl.right_filtered, r_int(right_raw), alpha);
+    ctl.is_initialized = true;
+
+    // Calculate centering error
+    real_t error = 0;
+    bool have_both_sides = left_valid && right_valid;
+    if (front_valid && (left_valid || right_valid)) {
+        error = left_valid ? (ctl.left_filtered - ctl.center_mm) : (ctl.center_mm - ctl.right_filtered);
+    } else if (have_both_sides) {
+        error = ctl.left_filtered - ctl.right_filtered;
+        ctl.center_mm = r_lpf(ctl.center_mm, (ctl.left_filtered + ctl.right_filtered) / 2, REAL(CENTER_ALPHA));
+        if (!is_corner) wall_fix(-error / 2);   // Only two walls place the robot for sure
+    } else if (left_valid) {
+        error = ctl.left_filtered - ctl.center_mm;
+    } else if (right_valid) {
+        error = ctl.center_mm - ctl.right_filtered;
+    }
+    if (!have_both_sides || front_valid || is_corner) ctl.fix_run = false;
+
+    // Change per nominal ToF period, scaled by the time that really passed between readings
+    real_t error_change = error - ctl.prev_error;
+    uint32_t dt_us = sensors.tof_us - ctl.tof_us;
+    if (dt_us) {
+        int32_t dt = clamp_int((int32_t)dt_us, TOF_PERIOD_MS * 250, TOF_PERIOD_MS * 4000);
+        error_change = r_scale(error_change, TOF_PERIOD_MS * 1000, dt);
+    }
+    ctl.tof_us = sensors.tof_us;
+    real_t error_derivative = r_clamp(error_change, REAL(-DE_MAX), REAL(DE_MAX));
+    ctl.prev_error = error;
+
+    // Adjust forward speed
+    real_t slow_scale = REAL_ONE;
+    if (is_corner || (front_valid && (left_valid || right_valid))) {
+        slow_scale = REAL(0.5f);
+    } else if (r_abs(error) > REAL(E_BAD_THRESH) || r_abs(error_derivative) > REAL(DE_BAD_THRESH)) {
+        slow_scale = REAL(0.55f);
+    } else if (have_both_sides) {
+        real_t badness = r_min(r_mul(r_abs(error), REAL(1.0f / E_BAD_THRESH)), REAL_ONE);
+        slow_scale = REAL(0.85f) + r_mul(REAL(0.15f), REAL_ONE - badness);
+    }
+    ctl.forward_speed = r_max(r_mul(base_speed, slow_scale), REAL(MIN_FWD_SPEED));
+
+    // Side wall part of the steering correction
+    real_t kp = is_corner ? Params_Real(PARAM_KP_SIDE) / 2 : Params_Real(PARAM_KP_SIDE);
+    real_t kd = is_corner ? Params_Real(PARAM_KD_SIDE) / 2 : Params_Real(PARAM_KD_SIDE);
+    ctl.side_correction = (left_valid || right_valid) ? (r_mul(kp, error) + r_mul(kd, error_derivative)) : 0;
+}
+
+static bool straight_step(void) {
+    // Travel since the move started
+    int left_count = left_ticks();
+    int right_count = right_ticks();
+    int avg_count = (left_count + right_count) / 2;
+
+    // ToF data arrives slower than the control tick; only filter fresh samples
+    if (sensors.tof_seq != ctl.tof_seq) {
+        ctl.tof_seq = sensors.tof_seq;
+        straight_update_tof();
+    }
+
+    // The wall filter caps the cruise speed; the profile ramps towards it
+    real_t forward = profile_step(ctl.forward_speed, avg_count);
+
+    // Apply steering correction
+    real_t enc_correction = r_mul(Params_Real(PARAM_KENC), r_int(left_count - right_count));
+    real_t correction = enc_correction + ctl.side_correction;
+
+    set_wheel_speeds(forward - correction, forward + correction);
 
-        if (HAL_GetTick() > turn_cooldown_end && is_tof_valid(front_raw)) {
-            if ((selectedTurnIndex == 0 && front_raw <= 90) ||
-                (selectedTurnIndex == 1 && front_raw <= 150)) {
-                reset_motion();
-                break;
-            }
+    // Check stop conditions
+    odometry_step(avg_count);
+    if (avg_count >= ctl.cmd.ticks - offset_shift_ticks(-ctl.cross_mm)) {
+        ctl.along_mm -= ctl.line_mm;    // Now from the waypoint at its end
+        return true;
+    }
+
+    uint8_t front_raw = sensors.front;
+    if (avg_count >= ctl.front_arm_ticks && is_tof_valid(front_raw)) {
+        if ((turn_mode == TURN_PIVOT && front_raw <= FRONT_STOP_PIVOT) ||
+            (turn_mode == TURN_CURVE && front_raw <= FRONT_STOP_CURVE)) {
+            reset_motion();
+            ctl.front_stopped = true;
+            if (turn_mode == TURN_CURVE) ctl.ahead_mm = FRONT_STOP_PIVOT - FRONT_STOP_CURVE;
+            return true;
         }
     }
+    return false;
 }
 
 /**
- * Performs a pivot turn to a specified angle using MPU yaw feedback.
+ * Drives along a 45 degree diagonal, cmd.ticks from waypoint to waypoint.
+ * Side walls are not parallel here, so it steers back onto the line the entry
+ * turn aimed at from odometry and the gyro, instead of centering on ToF readings.
  */
-void turn_pivot(float target_deg) {
-    if (fabsf(target_deg) < 0.1f) return;
+static void diagonal_start(void) {
+    reset_encoders();
+    ctl.odo_ticks = 0;
+    ctl.line_mm = r_mul(r_int(ctl.cmd.ticks), mm_per_tick);
+    ctl.ahead_mm = 0;
 
-    reset_motion();
-    MPU_Update();
+    // The entry turn's odometry carries on: less what it already covered and the exit arc
+    ctl.cmd.ticks -= r_toint(r_div(ctl.along_mm, mm_per_tick)) + lead_in_ticks();
 
-    float desired_yaw = MPU_GetYaw() + target_deg;
-    if (desired_yaw > 180.0f) desired_yaw -= 360.0f;
-    if (desired_yaw < -180.0f) desired_yaw += 360.0f;
+    real_t cruise = get_base_speed();
+    Profile_Start(&ctl.profile, r_mul(r_int(ctl.cmd.ticks), mm_per_tick), ctl.velocity, cruise, exit_speed(cruise));
+}
 
-    int direction = (target_deg > 0) ? 1 : -1;
-    int expected_ticks = (int)(TICKS_PER_TURN * (fabsf(target_deg) / 90.0f));
+static bool diagonal_step(void) {
+    int left_count = left_ticks();
+    int right_count = right_ticks();
+    int avg_count = (left_count + right_count) / 2;
+    odometry_step(avg_count);
+    if (avg_count >= ctl.cmd.ticks - offset_shift_ticks(-ctl.cross_mm)) {
+        ctl.along_mm -= ctl.line_mm;    // Now from the exit turn's waypoint
+        return true;
+    }
 
-    ENCODER_ResetLeft();
-    ENCODER_ResetRight();
-    uint32_t last_update = HAL_GetTick();
+    real_t base_speed = profile_step(get_base_speed(), avg_count);
 
-    while (true) {
-        if (HAL_GetTick() - last_update < LOOP_DT_MS) continue;
-        last_update = HAL_GetTick();
+    // Aim back at the line, more steeply the farther off it
+    real_t steer = r_clamp(r_mul(ctl.cross_mm, REAL(DIAG_STEER_PER_MM)), REAL(-DIAG_STEER_MAX), REAL(DIAG_STEER_MAX));
+    real_t yaw_error = wrap_deg(ctl.heading - steer - sensors.yaw);
 
-        MPU_Update();
-        float error = desired_yaw - MPU_GetYaw();
-        if (error > 180.0f) error -= 360.0f;
-        if (error < -180.0f) error += 360.0f;
+    // Positive yaw error means the robot drifted right: speed up the right wheel
+    real_t correction = r_mul(Params_Real(PARAM_KP_DIAG_YAW), yaw_error) +
+                        r_mul(Params_Real(PARAM_KENC), r_int(left_count - right_count));
 
-        if (fabsf(error) < 0.1f) {
-            reset_motion();
-            break;
-        }
+    set_wheel_speeds(base_speed - correction, base_speed + correction);
+    return false;
+}
 
-        int base_turn_speed = clamp_int((int)(2.0f * fabsf(error)), 100, TURN_BASE_SPEED);
-        if (fabsf(error) < 45.0f) {
-            base_turn_speed = clamp_int((int)(base_turn_speed * fabsf(error) / 45.0f), 100, base_turn_speed);
-        }
+/**
+ * Performs a pivot turn to a specified angle using MPU yaw feedback.
+ */
+static void pivot_start(void) {
+    reset_motion();
 
-        DRV8833_SetSpeed(&motorL, -direction * base_turn_speed);
-        DRV8833_SetSpeed(&motorR, direction * (int)(base_turn_speed * 1.2f));
+    ctl.desired_yaw = wrap_deg(ctl.heading + ctl.cmd.deg);
+    ctl.heading = ctl.desired_yaw;
+    ctl.direction = (ctl.cmd.deg > 0) ? 1 : -1;
+    ctl.expected_ticks = r_toint(r_muldiv(r_abs(ctl.cmd.deg), Params_Real(PARAM_TICKS_PER_TURN), REAL(90)));
 
-        if (abs(ENCODER_GetLeft() - ENCODER_GetRight()) / 2 > (int)(expected_ticks * 1.2f)) {
-            reset_motion();
-            break;
-        }
+    // Turning around puts an offset along the heading on the other side of the centre;
+    // a quarter turn makes it sideways, which the wall centering takes out
+    ctl.ahead_mm = (r_abs(ctl.cmd.deg) > REAL(135)) ? -ctl.ahead_mm : 0;
+}
+
+static bool pivot_step(void) {
+    real_t error = wrap_deg(ctl.desired_yaw - sensors.yaw);
+    real_t abs_error = r_abs(error);
+
+    // Done within a tenth of a degree, or just past it: at the slowest turn
+    // rate one gyro sample to the next can step over that window
+    bool overshot = abs_error < REAL(45) && (error > 0) != (ctl.direction > 0);
+    if (abs_error < REAL(0.1f) || overshot) {
+        reset_motion();
+        return true;
     }
+
+    real_t base_turn_speed = r_clamp(r_mul(Params_Real(PARAM_KP_PIVOT), abs_error), REAL(MIN_PIVOT_SPEED),
+                                     Params_Real(PARAM_PIVOT_SPEED));
+    if (abs_error < REAL(45)) {
+        base_turn_speed = r_clamp(r_muldiv(base_turn_speed, abs_error, REAL(45)), REAL(MIN_PIVOT_SPEED), base_turn_speed);
+    }
+
+    real_t left_speed = (ctl.direction > 0) ? -base_turn_speed : base_turn_speed;
+    set_wheel_speeds(left_speed, -left_speed);
+
+    if (abs(left_ticks() - right_ticks()) / 2 > ctl.expected_ticks * 6 / 5) {
+        reset_motion();
+        return true;
+    }
+    return false;
 }
 
 /**
  * Performs a curved turn to a specified angle using differential wheel speeds and MPU yaw feedback.
  */
-void turn_curve(float target_deg) {
-    if (fabsf(target_deg) < 0.1f) return;
+static void curve_start(void) {
+    reset_encoders();
+    ctl.velocity = Params_Real(PARAM_CURVE_SPEED);
 
-    reset_motion();
-    MPU_Update();
+    ctl.desired_yaw = wrap_deg(ctl.heading + ctl.cmd.deg);
+    ctl.heading = ctl.desired_yaw;
+    ctl.direction = (ctl.cmd.deg > 0) ? 1 : -1; // Positive for left turn, negative for right
+    ctl.ahead_mm = CURVE_EXIT_MM;
+}
+
+static bool curve_step(void) {
+    real_t error = wrap_deg(ctl.desired_yaw - sensors.yaw);
+
+    // The control tick brakes if nothing is queued behind the turn
+    if (r_abs(error) < REAL(YAW_TOLERANCE)) return true;
+
+    // Proportional control for smooth turning
+    real_t correction = r_mul(Params_Real(PARAM_KP_YAW), error);
+    real_t outer_speed = Params_Real(PARAM_CURVE_SPEED);
+    real_t inner_speed = r_clamp(outer_speed - r_abs(correction), REAL(MIN_CURVE_SPEED), outer_speed);
+
+    // Apply speeds based on turn direction
+    if (ctl.direction > 0) { // Left turn: left wheel slower
+        set_wheel_speeds(inner_speed, outer_speed);
+    } else { // Right turn: right wheel slower
+        set_wheel_speeds(outer_speed, inner_speed);
+    }
+    return false;
+}
+
+/**
+ * Performs a moving 45 or 135 degree turn into or out of a diagonal using MPU yaw feedback.
+ * Both wheels keep driving forward so the robot carries its speed through the turn;
+ * the inner wheel ratio sets the arc, which runs out on the new heading.
+ */
+static void diag_turn_start(void) {
+    reset_encoders();
+    ctl.odo_ticks = 0;
+    ctl.velocity = Params_Real(PARAM_CURVE_SPEED);
+
+    // Only a straight or a diagonal leaves the odometry at the waypoint
+    if (ctl.prev_type != CMD_STRAIGHT && ctl.prev_type != CMD_DIAGONAL) {
+        ctl.along_mm = -diag_lead_mm(ctl.cmd.deg);
+        ctl.cross_mm = 0;
+    }
+
+    // Into the frame of the line out of the waypoint
+    real_t c = r_cos_deg(ctl.cmd.deg), s = r_sin_deg(ctl.cmd.deg);
+    real_t along = r_mul(ctl.along_mm, c) + r_mul(ctl.cross_mm, s);
+    ctl.cross_mm = r_mul(ctl.cross_mm, c) - r_mul(ctl.along_mm, s);
+    ctl.along_mm = along;
 
-    ENCODER_ResetLeft();
-    ENCODER_ResetRight();
+    ctl.desired_yaw = wrap_deg(ctl.heading + ctl.cmd.deg);
+    ctl.heading = ctl.desired_yaw;
+    ctl.direction = (ctl.cmd.deg > 0) ? 1 : -1; // Positive for left turn
+    ctl.inner_ratio = (r_abs(ctl.cmd.deg) > REAL(90)) ? REAL(DIAG_INNER_135) : REAL(DIAG_INNER_45);
+}
+
+static bool diag_turn_step(void) {
+    const real_t outer_speed = Params_Real(PARAM_CURVE_SPEED);
+    real_t error = wrap_deg(ctl.desired_yaw - sensors.yaw);
+    odometry_step((left_ticks() + right_ticks()) / 2);
+
+    // Done once the error is small or the turn has gone past the target
+    if (r_abs(error) < REAL(YAW_TOLERANCE) || (ctl.direction > 0 ? error < 0 : error > 0)) {
+        ctl.ahead_mm = r_toint(ctl.along_mm);   // A straight out of it starts from here
+        return true;
+    }
 
-    float desired_yaw = MPU_GetYaw() + target_deg;
-    if (desired_yaw > 180.0f) desired_yaw -= 360.0f;
-    if (desired_yaw < -180.0f) desired_yaw += 360.0f;
+    real_t inner_speed = r_clamp(r_mul(outer_speed, ctl.inner_ratio), REAL(MIN_CURVE_SPEED), outer_speed);
 
-    int direction = (target_deg > 0) ? 1 : -1; // Positive for left turn, negative for right
+    if (ctl.direction > 0) { // Left turn: left wheel slower
+        set_wheel_speeds(inner_speed, outer_speed);
+    } else {                 // Right turn: right wheel slower
+        set_wheel_speeds(outer_speed, inner_speed);
+    }
+    return false;
+}
+
+/* ==================== Control Loop ==================== */
+static void cmd_start(void) {
+    // Parameters only change while the robot stands still
+    mm_per_tick = r_div(REAL(CELL_MM), Params_Real(PARAM_TICKS_PER_CELL));
+
+    // Turns aim from the maze heading, not the yaw they start at: a straight
+    // weaves a few degrees between the walls. Started from rest, the robot is taken as square
+    if (!ctl.heading_set) {
+        ctl.heading = sensors.yaw;
+        ctl.heading_set = true;
+    }
+
+    // Only a front-wall stop puts the robot where a curve must begin; anywhere
+    // else the arc would end off the cell's centre line, so turn in place
+    if (ctl.cmd.type == CMD_CURVE && !(ctl.prev_type == CMD_STRAIGHT && ctl.front_stopped))
+        ctl.cmd.type = CMD_PIVOT;
+
+    switch (ctl.cmd.type) {
+        case CMD_STRAIGHT:  straight_start(); break;
+        case CMD_DIAGONAL:  diagonal_start(); break;
+        case CMD_PIVOT:     pivot_start(); break;
+        case CMD_CURVE:     curve_start(); break;
+        case CMD_DIAG_TURN: diag_turn_start(); break;
+    }
+    ctl.prev_type = ctl.cmd.type;
+}
 
-    ENCODER_ResetLeft();
-    ENCODER_ResetRight();
-    uint32_t last_update = HAL_GetTick();
+static bool cmd_step(void) {
+    switch (ctl.cmd.type) {
+        case CMD_STRAIGHT:  return straight_step();
+        case CMD_DIAGONAL:  return diagonal_step();
+        case CMD_PIVOT:     return pivot_step();
+        case CMD_CURVE:     return curve_step();
+        case CMD_DIAG_TURN: return diag_turn_step();
+    }
+    return true;
+}
 
-    while (true) {
-        if (HAL_GetTick() - last_update < LOOP_DT_MS) continue;
-        last_update = HAL_GetTick();
+static void control_step(void) {
+    // The thread cannot run while we do, so an even sequence means a whole snapshot
+    if (!(snapshot_seq & 1)) sensors = snapshot;
 
-        MPU_Update();
-        float error = desired_yaw - MPU_GetYaw();
-        if (error > 180.0f) error -= 360.0f;
-        if (error < -180.0f) error += 360.0f;
+    ENCODER_Read(&enc_left, &enc_right);
+    enc_us = Timebase_Us();
+    wheel_measure(&wheelL, enc_left, enc_us);
+    wheel_measure(&wheelR, enc_right, enc_us);
 
-        if (fabsf(error) < YAW_TOLERANCE) {
+    // Wheels driven but hardly turning: the robot is against a wall.
+    // Stop pushing and leave the rest of the run to the thread
+    if (cmd_active && wheels_enabled &&
+        r_abs(wheelL.target) + r_abs(wheelR.target) >= REAL(2 * MIN_PIVOT_SPEED) &&
+        r_abs(wheelL.speed) + r_abs(wheelR.speed) < REAL(MIN_PIVOT_SPEED / 4)) {
+        if (++stall_ticks >= MOTION_STALL_MS / LOOP_DT_MS) {
+            stalled = true;
+            cmd_head = cmd_tail;
+            cmd_active = false;
             reset_motion();
-            break;
         }
+    } else {
+        stall_ticks = 0;
+    }
 
-        // Proportional control for smooth turning
-        float correction = KP_YAW * error;
-        int outer_speed = BASE_CURVE_SPEED;
-        int inner_speed = clamp_int((int)(BASE_CURVE_SPEED - fabsf(correction)), MIN_CURVE_SPEED, BASE_CURVE_SPEED);
-
-        // Apply speeds based on turn direction
-        if (direction > 0) { // Left turn: left wheel slower
-            DRV8833_SetSpeed(&motorL, inner_speed);
-            DRV8833_SetSpeed(&motorR, (int)(outer_speed * MOTOR_R_GAIN));
-        } else { // Right turn: right wheel slower
-            DRV8833_SetSpeed(&motorL, outer_speed);
-            DRV8833_SetSpeed(&motorR, (int)(inner_speed * MOTOR_R_GAIN));
+    if (!cmd_active) {
+        // Once stalled, nothing more starts until Motion_Abort()
+        if (stalled || cmd_head == cmd_tail) {
+            ctl.heading_set = false;
+            return;
         }
+        ctl.cmd = cmd_queue[cmd_head & (MOTION_QUEUE_LEN - 1)];
+        cmd_head++;
+        cmd_active = true;
+        cmd_start();
+        active_type = ctl.cmd.type;     // A curve may have become a pivot
     }
+
+    if (cmd_step()) {
+        cmd_active = false;
+
+        // Nothing queued behind this move: stop rather than coast
+        if (cmd_head == cmd_tail) reset_motion();
+    }
+
+    if (wheels_enabled) {
+        pwm_left = (int16_t)wheel_output(&wheelL);
+        pwm_right = (int16_t)wheel_output(&wheelR);
+        DRV8833_SetSpeed(&motorL, pwm_left);
+        DRV8833_SetSpeed(&motorR, pwm_right);
+    }
+}
+
+/* One telemetry record per tick: plain stores, the scaling is a multiply and a shift */
+static void record_tick(void) {
+    TelemetryRecord *r = Telemetry_Slot();
+    if (!r) return;
+
+    r->t_us = enc_us;
+    r->enc_left = (int16_t)enc_left;
+    r->enc_right = (int16_t)enc_right;
+    r->tof_left = sensors.left;
+    r->tof_front = sensors.front;
+    r->tof_right = sensors.right;
+    r->state = (uint8_t)((cmd_active ? active_type : TELEMETRY_IDLE) | (wheels_enabled ? 0 : TELEMETRY_BRAKED));
+    r->left_filtered = (int16_t)r_toint(ctl.left_filtered * 16);
+    r->right_filtered = (int16_t)r_toint(ctl.right_filtered * 16);
+    r->yaw = (int16_t)r_toint(sensors.yaw * 100);
+    r->error = (cmd_active && active_type == CMD_STRAIGHT) ? (int16_t)r_toint(ctl.prev_error * 16)
+                                             : (int16_t)r_toint(wrap_deg(ctl.desired_yaw - sensors.yaw) * 100);
+    r->target_left = (int16_t)r_toint(wheelL.target);
+    r->target_right = (int16_t)r_toint(wheelR.target);
+    r->speed_left = (int16_t)r_toint(wheelL.speed);
+    r->speed_right = (int16_t)r_toint(wheelR.speed);
+    r->pwm_left = pwm_left;
+    r->pwm_right = pwm_right;
 }
 
 /**
- * Placeholder for diagonal movement.
+ * Fixed-rate control step, run from the TIM3 update interrupt every LOOP_DT_MS.
+ * Never touches the I2C bus: sensors come from the snapshot published by Motion_Service().
  */
-void turn_diagonal(void) {
-    reset_motion();
-    int base_speed = get_base_speed();
-    DRV8833_SetSpeed(&motorL, base_speed);
-    DRV8833_SetSpeed(&motorR, (int)(base_speed * MOTOR_R_GAIN));
-    HAL_Delay(400);
+void Motion_ControlTick(void) {
+    uint32_t t0 = Perf_Begin();
+    control_step();
+    record_tick();
+    Perf_End(PERF_CONTROL_TICK, t0);
+}
+
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
+    if (htim->Instance == TIM3) Motion_ControlTick();
+    else if (htim->Instance == TIM1) Buzzer_TimerTick();
+}
+
+/**
+ * Refreshes the sensor snapshot for the control tick. Call from thread context as
+ * often as possible; the gyro is read every millisecond and the free-running ToF
+ * sensors are collected as their results become ready.
+ */
+void Motion_Service(void) {
+    static uint32_t last_update;
+    static uint8_t published;   // Sum of the sensors' sample counters last published
+    uint32_t now = Timebase_Us();
+    if (now - last_update < 1000) return;
+    last_update = now;
+    uint32_t t0 = Perf_Begin();
+
+    MPU_Update();
+    real_t yaw = MPU_GetYawReal();
+
+    VL6180X_Poll(&tofLeft);
+    VL6180X_Poll(&tofRight);
+    VL6180X_Poll(&tofFront);
+
+    // Results may also have been collected by VL6180X_ReadRange() elsewhere
+    uint8_t samples = (uint8_t)(tofLeft.samples + tofRight.samples + tofFront.samples);
+    bool new_tof = (samples != published);
+    published = samples;
+
+    snapshot_seq++;
+    __DMB();
+    snapshot.yaw = yaw;
+    if (new_tof) {
+        snapshot.left = tofLeft.range;
+        snapshot.right = tofRight.range;
+        snapshot.front = tofFront.range;
+        uint32_t l = tofLeft.sample_us, r = tofRight.sample_us;
+        snapshot.tof_us = ((int32_t)(l - r) > 0) ? l : r;
+        snapshot.tof_seq++;
+    }
+    __DMB();
+    snapshot_seq++;
+    Perf_End(PERF_MOTION_SERVICE, t0);
+}
+
+bool Motion_Idle(void) {
+    return !cmd_active && cmd_head == cmd_tail;
+}
+
+/**
+ * Lets a continuous search commit its next move before the current one ends.
+ * Only the last queued move counts, so the next decision waits until the
+ * moves queued by the previous one have started.
+ */
+bool Motion_ApproachingEnd(int ticks) {
+    if (Motion_Idle()) return true;
+
+    // The command, its length and the travel against it, all from between two control ticks
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    bool straight = cmd_active && cmd_head == cmd_tail && active_type == CMD_STRAIGHT;
+    int remaining = ctl.cmd.ticks - (left_ticks() + right_ticks()) / 2;
+    if (!primask) __enable_irq();
+
+    return straight && remaining <= ticks;
+}
+
+void Motion_Wait(void) {
+    while (!Motion_Idle()) Motion_Service();
+}
+
+void Motion_SetTurnMode(TurnMode mode) {
+    turn_mode = mode;
+}
+
+void Motion_Abort(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    cmd_head = cmd_tail;
+    cmd_active = false;
+    stalled = false;
+    stall_ticks = 0;
     reset_motion();
+
+    // The next run starts where a hand puts the robot, not where this one stopped
+    ctl.ahead_mm = 0;
+    ctl.front_stopped = false;
+    ctl.heading_set = false;
+    if (!primask) __enable_irq();
+}
+
+bool Motion_Stalled(void) {
+    return stalled;
+}
+
+static void cmd_push(MotionCmd cmd) {
+    // Block only while the queue is full, keeping the running move fed
+    while ((uint8_t)(cmd_tail - cmd_head) >= MOTION_QUEUE_LEN) Motion_Service();
+
+    // A stall dropped the queue; the rest of the run is dropped with it
+    if (stalled) return;
+
+    cmd_queue[cmd_tail & (MOTION_QUEUE_LEN - 1)] = cmd;
+    __DMB();
+    cmd_tail++;
+}
+
+/**
+ * Queues a compiled move for the control loop and returns without waiting for it.
+ */
+void Motion_Enqueue(Move move) {
+    const int ticks_per_cell = get_ticks_per_cell();
+
+    switch (move.type) {
+        case MOVE_STRAIGHT:
+            cmd_push((MotionCmd){ CMD_STRAIGHT, (int32_t)(ticks_per_cell * move.len / 2), 0 });
+            break;
+        case MOVE_TURN_LEFT:
+        case MOVE_TURN_RIGHT: {
+            real_t deg = (move.type == MOVE_TURN_LEFT) ? REAL(90) : REAL(-90);
+            cmd_push((MotionCmd){ turn_mode == TURN_PIVOT ? CMD_PIVOT : CMD_CURVE, 0, deg });
+        } break;
+        case MOVE_TURN_AROUND:
+            cmd_push((MotionCmd){ CMD_PIVOT, 0, REAL(180) });
+            break;
+        case MOVE_DIAGONAL:
+            cmd_push((MotionCmd){ CMD_DIAGONAL, (int32_t)(ticks_per_cell * move.len * DIAG_SEG_RATIO), 0 });
+            break;
+        case MOVE_TURN_L45:  cmd_push((MotionCmd){ CMD_DIAG_TURN, 0, REAL(45) }); break;
+        case MOVE_TURN_R45:  cmd_push((MotionCmd){ CMD_DIAG_TURN, 0, REAL(-45) }); break;
+        case MOVE_TURN_L135: cmd_push((MotionCmd){ CMD_DIAG_TURN, 0, REAL(135) }); break;
+        case MOVE_TURN_R135: cmd_push((MotionCmd){ CMD_DIAG_TURN, 0, REAL(-135) }); break;
+    }
+}
+
+/* ==================== Blocking Movements ==================== */
+
+/**
+ * Drives forward for a specified number of cells.
+ */
+void driveForward(int cells) {
+    driveHalfCells(2 * cells);
+}
+
+/**
+ * Drives forward for a number of half cells (speed-run straights around diagonals).
+ */
+void driveHalfCells(int half_cells) {
+    if (half_cells <= 0) return;
+    Motion_Enqueue((Move){ MOVE_STRAIGHT, (uint8_t)half_cells });
+    Motion_Wait();
+}
+
+/**
+ * Drives along a 45 degree diagonal for a number of edge-to-edge segments.
+ */
+void driveDiagonal(int segments) {
+    if (segments <= 0) return;
+    Motion_Enqueue((Move){ MOVE_DIAGONAL, (uint8_t)segments });
+    Motion_Wait();
+}
+
+void turn_pivot(float target_deg) {
+    if (fabsf(target_deg) < 0.1f) return;
+    cmd_push((MotionCmd){ CMD_PIVOT, 0, r_float(target_deg) });
+    Motion_Wait();
+}
+
+void turn_curve(float target_deg) {
+    if (fabsf(target_deg) < 0.1f) return;
+    cmd_push((MotionCmd){ CMD_CURVE, 0, r_float(target_deg) });
+    Motion_Wait();
+}
+
+void turn_diagonal(float target_deg) {
+    if (fabsf(target_deg) < 0.1f) return;
+    cmd_push((MotionCmd){ CMD_DIAG_TURN, 0, r_float(target_deg) });
+    Motion_Wait();
 }
 
 /**
  * Wrapper for 90-degree turns based on selected turn mode.
  */
 void turn90(bool left) {
-    extern int selectedTurnIndex;
-    switch (selectedTurnIndex) {
-        case 0: turn_pivot(left ? 90.0f : -90.0f); break;
-        case 1: turn_curve(left ? 90.0f : -90.0f); break;
-        case 2: turn_diagonal(); break;
-        default: break;
-    }
+    Motion_Enqueue((Move){ left ? MOVE_TURN_LEFT : MOVE_TURN_RIGHT, 0 });
+    Motion_Wait();
 }
 
 /**
@@ -320,3 +1002,116 @@ void turn90(bool left) {
 void turn180(void) {
     turn_pivot(180.0f);
 }
+
+/**
+ * Compiles a per-cell heading list into turns and merged straight runs.
+ * Straight lengths are in half cells. moves[] must hold up to 2 * length entries.
+ * Returns the number of moves.
+ */
+int compilePath(const Direction path[], int length, Direction startDir, Move moves[]) {
+    Direction heading = startDir;
+    int count = 0;
+
+    for (int i = 0; i < length; i++) {
+        int rotation = (path[i] - heading + 4) % 4;
+        switch (rotation) {
+            case 1: moves[count++] = (Move){ MOVE_TURN_RIGHT, 0 }; break;
+            case 2: moves[count++] = (Move){ MOVE_TURN_AROUND, 0 }; break;
+            case 3: moves[count++] = (Move){ MOVE_TURN_LEFT, 0 }; break;
+            default: break;
+        }
+        heading = path[i];
+
+        if (count > 0 && moves[count - 1].type == MOVE_STRAIGHT && moves[count - 1].len <= UINT8_MAX - 2) {
+            moves[count - 1].len += 2;
+        } else {
+            moves[count++] = (Move){ MOVE_STRAIGHT, 2 };
+        }
+    }
+    return count;
+}
+
+static inline bool is_turn90(Move m) {
+    return m.type == MOVE_TURN_LEFT || m.type == MOVE_TURN_RIGHT;
+}
+
+static inline bool is_straight(Move m, int min_len) {
+    return m.type == MOVE_STRAIGHT && m.len >= min_len;
+}
+
+/**
+ * Rewrites staircase sections of a compiled path into diagonal runs.
+ * A staircase is two or more alternating left/right turns one cell apart. Its
+ * diagonal runs edge midpoint to edge midpoint, one segment per turn, so the
+ * straights on either side give up half a cell. A same-direction turn one cell
+ * before or after the staircase is folded in as a 135 degree entry or exit; its
+ * corner is that cell's far edge midpoint, so the straight gains half a cell and
+ * the diagonal one more segment.
+ * out[] must hold count entries. Returns the number of moves written.
+ */
+int compileDiagonals(const Move in[], int count, Move out[]) {
+    int n = 0;
+    int i = 0;
+
+    while (i < count) {
+        // Entry needs a 90 degree turn with at least a cell of straight before it
+        if (!is_turn90(in[i]) || n == 0 || !is_straight(out[n - 1], 2)) {
+            out[n++] = in[i++];
+            continue;
+        }
+
+        // Extend over alternating turns separated by exactly one cell
+        int j = i;
+        int turns = 1;
+        while (j + 2 < count && is_straight(in[j + 1], 2) && in[j + 1].len == 2 &&
+               is_turn90(in[j + 2]) && in[j + 2].type != in[j].type) {
+            j += 2;
+            turns++;
+        }
+        if (turns < 2 || j + 1 >= count || !is_straight(in[j + 1], 2)) {
+            out[n++] = in[i++];
+            continue;
+        }
+
+        bool left_in = (in[i].type == MOVE_TURN_LEFT);
+        bool left_out = (in[j].type == MOVE_TURN_LEFT);
+
+        // Entry: 135 if the previous move pair is a same-direction turn one cell back
+        bool in135 = n >= 3 && out[n - 1].len == 2 && out[n - 2].type == in[i].type &&
+                     is_straight(out[n - 3], 2);
+        if (in135) {
+            n -= 2;
+            out[n - 1].len++;
+            out[n++] = (Move){ left_in ? MOVE_TURN_L135 : MOVE_TURN_R135, 0 };
+        } else {
+            out[n - 1].len--;
+            out[n++] = (Move){ left_in ? MOVE_TURN_L45 : MOVE_TURN_R45, 0 };
+        }
+
+        out[n++] = (Move){ MOVE_DIAGONAL, (uint8_t)(turns + in135) };
+
+        // Exit: 135 if a same-direction turn follows one cell later
+        bool out135 = j + 3 < count && in[j + 1].len == 2 && in[j + 2].type == in[j].type &&
+                      is_straight(in[j + 3], 2);
+        if (out135) {
+            out[n - 1].len++;
+            out[n++] = (Move){ left_out ? MOVE_TURN_L135 : MOVE_TURN_R135, 0 };
+            out[n++] = (Move){ MOVE_STRAIGHT, (uint8_t)(in[j + 3].len + 1) };
+            i = j + 4;
+        } else {
+            out[n++] = (Move){ left_out ? MOVE_TURN_L45 : MOVE_TURN_R45, 0 };
+            out[n++] = (Move){ MOVE_STRAIGHT, (uint8_t)(in[j + 1].len - 1) };
+            i = j + 2;
+        }
+    }
+    return n;
+}
+
+/**
+ * Queues compiled moves and returns; straights run as single accelerated segments.
+ */
+void runMoves(const Move moves[], int count) {
+    for (int i = 0; i < count && !Motion_Stalled(); i++) {
+        Motion_Enqueue(moves[i]);
+    }
+}
@@ -0,0 +1,255 @@
+#include "params.h"
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MILLI(x)        ((int32_t)((x) * 1000.0 + 0.5))
+#define PARAMS_MAGIC    (0x50524D00u | PARAMS_VERSION)  // "PRM" + version
+
+typedef struct {
+    const char *name;   // Up to 9 characters: the menu shows it beside the value
+    int32_t def, min, max, step;
+} ParamInfo;
+
+static const ParamInfo INFO[PARAM_COUNT] = {
+    [PARAM_KP_SIDE]        = { "kp_side",   MILLI(3.0),            0, MILLI(20),    MILLI(0.1) },
+    [PARAM_KD_SIDE]        = { "kd_side",   MILLI(10.0),           0, MILLI(50),    MILLI(0.5) },
+    [PARAM_KENC]           = { "k_enc",     MILLI(0.75),           0, MILLI(5),     MILLI(0.05) },
+    [PARAM_KP_DIAG_YAW]    = { "kp_diag",   MILLI(13.0),           0, MILLI(50),    MILLI(0.5) },
+    [PARAM_KP_YAW]         = { "kp_yaw",    MILLI(50.0),           0, MILLI(200),   MILLI(1) },
+    [PARAM_KP_PIVOT]       = { "kp_pivot",  MILLI(6.0),            0, MILLI(50),    MILLI(0.5) },
+    [PARAM_CURVE_SPEED]    = { "curve_v",   MILLI(400.0),  MILLI(100), MILLI(1000), MILLI(10) },
+    [PARAM_PIVOT_SPEED]    = { "pivot_v",   MILLI(TURN_BASE_SPEED), MILLI(80), MILLI(600), MILLI(10) },
+    [PARAM_KS_WHEEL]       = { "ks_wheel",  MILLI(80.0),           0, MILLI(255),   MILLI(1) },
+    [PARAM_KV_WHEEL]       = { "kv_wheel",  MILLI(0.30),           0, MILLI(2),     MILLI(0.01) },
+    [PARAM_KA_WHEEL]       = { "ka_wheel",  MILLI(0.02),           0, MILLI(0.5),   MILLI(0.005) },
+    [PARAM_KP_WHEEL]       = { "kp_wheel",  MILLI(0.4),            0, MILLI(5),     MILLI(0.05) },
+    [PARAM_KI_WHEEL]       = { "ki_wheel",  MILLI(20.0),           0, MILLI(100),   MILLI(1) },
+    [PARAM_KD_WHEEL]       = { "kd_wheel",  MILLI(0.0),            0, MILLI(1),     MILLI(0.005) },
+    [PARAM_SPEED_MEDIUM]   = { "v_medium",  MILLI(SPEED_MEDIUM), MILLI(100), MILLI(1500), MILLI(10) },
+    [PARAM_SPEED_FAST]     = { "v_fast",    MILLI(SPEED_FAST),   MILLI(100), MILLI(2000), MILLI(10) },
+    [PARAM_ACCEL]          = { "accel",     MILLI(PROFILE_ACCEL), MILLI(200), MILLI(10000), MILLI(100) },
+    [PARAM_DECEL]          = { "decel",     MILLI(PROFILE_DECEL), MILLI(200), MILLI(10000), MILLI(100) },
+    [PARAM_TICKS_PER_CELL] = { "tick_cell", MILLI(TICKS_PER_CELL), MILLI(1000), MILLI(3000), MILLI(5) },
+    [PARAM_TICKS_PER_TURN] = { "tick_turn", MILLI(TICKS_PER_TURN), MILLI(200), MILLI(1000), MILLI(5) },
+    [PARAM_FRONT_LIMIT]    = { "front_mm",  MILLI(SENSOR_FRONT_LIMIT), MILLI(20), MILLI(250), MILLI(5) },
+    [PARAM_SIDE_LIMIT]     = { "side_mm",   MILLI(SENSOR_SIDE_LIMIT),  MILLI(10), MILLI(150), MILLI(1) },
+};
+
+/* One saved table. Saves append records to the current page; when it is full
+   the next page is erased and filled, so the newest record always survives an
+   erase or a reset in the middle of a write. */
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;               // Save counter: the highest valid record is current
+    int32_t values[PARAM_COUNT];
+    uint32_t crc;               // CRC-32 of the fields above
+} ParamsRecord;
+
+#define SLOTS_PER_PAGE  (FLASH_PAGE_SIZE / sizeof(ParamsRecord))
+
+_Static_assert(sizeof(ParamsRecord) % 4 == 0, "records are programmed a word at a time");
+_Static_assert(PARAMS_FLASH_PAGES >= 2, "a full page must survive while the next one is erased");
+
+real_t params_real[PARAM_COUNT];
+static int32_t values[PARAM_COUNT];
+static uint32_t seq;            // Of the record last loaded or saved, 0 for none
+static int page;                // Page holding that record
+static uint32_t next_slot;      // First unused slot behind it, SLOTS_PER_PAGE when full
+static bool dirty;
+
+static uint32_t page_addr(int p) {
+    return PARAMS_FLASH_ADDR + (uint32_t)p * FLASH_PAGE_SIZE;
+}
+
+static const ParamsRecord *slot(int p, uint32_t i) {
+    return (const ParamsRecord *)(uintptr_t)(page_addr(p) + i * sizeof(ParamsRecord));
+}
+
+static uint32_t crc32(const void *data, size_t len) {
+    const uint8_t *p = data;
+    uint32_t crc = 0xFFFFFFFFu;
+    while (len--) {
+        crc ^= *p++;
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+    }
+    return ~crc;
+}
+
+static bool blank(const void *data, size_t len) {
+    const uint32_t *w = data;
+    for (size_t i = 0; i < len / 4; i++)
+        if (w[i] != 0xFFFFFFFFu) return false;
+    return true;
+}
+
+static bool valid(const ParamsRecord *r) {
+    return r->magic == PARAMS_MAGIC && r->crc == crc32(r, offsetof(ParamsRecord, crc));
+}
+
+static void apply(ParamId id, int32_t milli) {
+    values[id] = milli;
+    params_real[id] = r_scale(REAL_ONE, milli, 1000);
+}
+
+void Params_Init(void) {
+    Params_Load();
+}
+
+int32_t Params_Int(ParamId id) {
+    int32_t v = values[id];
+    return (v >= 0 ? v + 500 : v - 500) / 1000;
+}
+
+int32_t Params_Get(ParamId id) {
+    return values[id];
+}
+
+bool Params_Set(ParamId id, int32_t milli) {
+    const ParamInfo *p = &INFO[id];
+    int32_t v = (milli < p->min) ? p->min : (milli > p->max) ? p->max : milli;
+    if (v != values[id]) dirty = true;
+    apply(id, v);
+    return v == milli;
+}
+
+int32_t Params_Step(ParamId id) {
+    return INFO[id].step;
+}
+
+const char *Params_Name(ParamId id) {
+    return INFO[id].name;
+}
+
+int Params_Find(const char *name) {
+    for (int i = 0; i < PARAM_COUNT; i++)
+        if (strcmp(name, INFO[i].name) == 0) return i;
+    return -1;
+}
+
+int Params_Format(int32_t milli, char *buf, size_t size) {
+    unsigned long a = (milli < 0) ? 0ul - (unsigned long)milli : (unsigned long)milli;
+    unsigned long frac = a % 1000;
+    int digits = 3;
+    if (frac == 0) return snprintf(buf, size, "%s%lu", milli < 0 ? "-" : "", a / 1000);
+    while (frac % 10 == 0) {
+        frac /= 10;
+        digits--;
+    }
+    return snprintf(buf, size, "%s%lu.%0*lu", milli < 0 ? "-" : "", a / 1000, digits, frac);
+}
+
+// Decimal with up to three places (more are dropped), without strtof
+bool Params_Parse(const char *text, int32_t *milli) {
+    const char *s = text;
+    bool negative = (*s == '-');
+    if (*s == '-' || *s == '+') s++;
+
+    int32_t whole = 0, frac = 0, scale = 1000;
+    bool digits = false;
+    for (; *s >= '0' && *s <= '9'; s++, digits = true) {
+        whole = whole * 10 + (*s - '0');
+        if (whole > (INT32_MAX - 999) / 1000) return false;    // Would overflow in thousandths
+    }
+    if (*s == '.') {
+        for (s++; *s >= '0' && *s <= '9'; s++, digits = true) {
+            if (scale > 1) {
+                scale /= 10;
+                frac += (*s - '0') * scale;
+            }
+        }
+    }
+    if (!digits || *s) return false;
+
+    *milli = (whole * 1000 + frac) * (negative ? -1 : 1);
+    return true;
+}
+
+bool Params_Dirty(void) {
+    return dirty;
+}
+
+void Params_Defaults(void) {
+    for (int i = 0; i < PARAM_COUNT; i++) Params_Set((ParamId)i, INFO[i].def);
+}
+
+bool Params_Load(void) {
+    const ParamsRecord *best = NULL;
+    int best_page = 0;
+    for (int p = 0; p < PARAMS_FLASH_PAGES; p++) {
+        for (uint32_t i = 0; i < SLOTS_PER_PAGE; i++) {
+            const ParamsRecord *r = slot(p, i);
+            if (valid(r) && (!best || (int32_t)(r->seq - best->seq) > 0)) {
+                best = r;
+                best_page = p;
+            }
+        }
+    }
+
+    if (!best) {
+        for (int i = 0; i < PARAM_COUNT; i++) apply((ParamId)i, INFO[i].def);
+        seq = 0;
+        page = PARAMS_FLASH_PAGES - 1;      // The first save starts on page 0
+        next_slot = SLOTS_PER_PAGE;
+        dirty = false;
+        return false;
+    }
+
+    // A value the current table rejects falls back to its default
+    for (int i = 0; i < PARAM_COUNT; i++) {
+        int32_t v = best->values[i];
+        apply((ParamId)i, (v >= INFO[i].min && v <= INFO[i].max) ? v : INFO[i].def);
+    }
+    seq = best->seq;
+    page = best_page;
+
+    // Half-written slots behind the record stay unused until the page is erased
+    next_slot = SLOTS_PER_PAGE;
+    while (next_slot > 0 && blank(slot(page, next_slot - 1), sizeof(ParamsRecord))) next_slot--;
+    dirty = false;
+    return true;
+}
+
+static bool erase_page(int p) {
+    FLASH_EraseInitTypeDef erase = {
+        .TypeErase = FLASH_TYPEERASE_PAGES,
+        .PageAddress = page_addr(p),
+        .NbPages = 1,
+    };
+    uint32_t error;
+    return HAL_FLASHEx_Erase(&erase, &error) == HAL_OK;
+}
+
+bool Params_Save(void) {
+    if (!dirty && seq != 0) return true;    // Flash already holds this table
+
+    ParamsRecord r = { .magic = PARAMS_MAGIC, .seq = seq + 1 };
+    memcpy(r.values, values, sizeof(r.values));
+    r.crc = crc32(&r, offsetof(ParamsRecord, crc));
+
+    int p = page;
+    uint32_t i = next_slot;
+    if (i >= SLOTS_PER_PAGE) {
+        p = (page + 1) % PARAMS_FLASH_PAGES;
+        i = 0;
+    }
+
+    HAL_FLASH_Unlock();
+    bool ok = (i != 0) || blank((const void *)(uintptr_t)page_addr(p), FLASH_PAGE_SIZE) || erase_page(p);
+    if (ok) {
+        const uint32_t *src = (const uint32_t *)&r;
+        uint32_t addr = page_addr(p) + i * sizeof(ParamsRecord);
+        for (size_t w = 0; ok && w < sizeof(r) / 4; w++) {
+            ok = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, addr + w * 4, src[w]) == HAL_OK;
+        }
+        // Even a failed write has used the slot up
+        page = p;
+        next_slot = i + 1;
+    }
+    HAL_FLASH_Lock();
+
+    if (!ok || memcmp(slot(p, i), &r, sizeof(r)) != 0) return false;
+    seq = r.seq;
+    dirty = false;
+    return true;
+}
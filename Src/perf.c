@@ -0,0 +1,91 @@
+#include "perf.h"
+#include "OLED.h"
+#include <stdio.h>
+
+static const char *const NAMES[PERF_ZONE_COUNT] = {
+    [PERF_FLOOD_RUN]      = "Flood",
+    [PERF_FLOOD_UPDATE]   = "Repair",
+    [PERF_TOF_READ]       = "ToF",
+    [PERF_MOTION_SERVICE] = "Sensor",
+    [PERF_CONTROL_TICK]   = "Ctrl",
+    [PERF_OLED_PRINT]     = "Print",
+    [PERF_OLED_FLUSH]     = "Flush",
+};
+
+// A HAL may offer a PRIMASK read that costs nothing; the simulator's ordinary one
+// moves simulated time on, and the bookkeeping must not change what it measures
+#ifndef PERF_GET_PRIMASK
+#define PERF_GET_PRIMASK()  __get_PRIMASK()
+#endif
+
+static PerfStats zones[PERF_ZONE_COUNT];
+
+#if PERF_ZONES
+void Perf_End(PerfZone zone, uint32_t start) {
+    uint32_t ticks = perf_now() - start;
+
+    // The control tick ends its zone from an interrupt
+    uint32_t primask = PERF_GET_PRIMASK();
+    __disable_irq();
+
+    PerfStats *z = &zones[zone];
+    if (z->count == 0 || ticks < z->min) z->min = ticks;
+    if (ticks > z->max) z->max = ticks;
+    z->total += ticks;
+    z->count++;
+
+    if (!primask) __enable_irq();
+}
+#endif
+
+void Perf_Reset(void) {
+    uint32_t primask = PERF_GET_PRIMASK();
+    __disable_irq();
+    for (int i = 0; i < PERF_ZONE_COUNT; i++) zones[i] = (PerfStats){ 0 };
+    if (!primask) __enable_irq();
+}
+
+void Perf_Get(PerfZone zone, PerfStats *out) {
+    uint32_t primask = PERF_GET_PRIMASK();
+    __disable_irq();
+    *out = zones[zone];
+    if (!primask) __enable_irq();
+}
+
+const char *Perf_Name(PerfZone zone) {
+    return NAMES[zone];
+}
+
+// Ticks to tenths of a microsecond
+static unsigned long tenths_us(uint64_t ticks) {
+    return (unsigned long)(ticks * 10 / PERF_TICKS_PER_US);
+}
+
+int Perf_Format(PerfZone zone, char *buf, size_t size) {
+    PerfStats z;
+    Perf_Get(zone, &z);
+    unsigned long min = tenths_us(z.min), max = tenths_us(z.max);
+    unsigned long mean = z.count ? tenths_us(z.total / z.count) : 0;
+
+    return snprintf(buf, size, "%-6s %8lu %7lu.%lu %7lu.%lu %7lu.%lu", NAMES[zone], (unsigned long)z.count,
+                    min / 10, min % 10, mean / 10, mean % 10, max / 10, max % 10);
+}
+
+void Perf_Draw(int page) {
+    char line[48];      // Wider than the panel: the values scale by a run-time clock, unbounded to the compiler
+
+    // 21 characters fit across the panel; one row per zone below the header
+    OLED_Clear();
+    snprintf(line, sizeof(line), "us%d/%d  min mean  max", page + 1, PERF_DRAW_PAGES);
+    OLED_Print(line, 0, 0);
+    for (int row = 1; row <= PERF_DRAW_ZONES; row++) {
+        int i = page * PERF_DRAW_ZONES + row - 1;
+        if (i >= PERF_ZONE_COUNT) break;
+        PerfStats z;
+        Perf_Get((PerfZone)i, &z);
+        unsigned long mean = z.count ? tenths_us(z.total / z.count) / 10 : 0;
+        snprintf(line, sizeof(line), "%-6.6s%4lu %4lu %4lu", NAMES[i],
+                 tenths_us(z.min) / 10, mean, tenths_us(z.max) / 10);
+        OLED_Print(line, (uint8_t)row, 0);
+    }
+}
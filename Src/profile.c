@@ -0,0 +1,74 @@
+#include "profile.h"
+#include "config.h"
+#include "params.h"
+
+void Profile_Start(Profile *p, real_t distance, real_t v_start, real_t v_max, real_t v_end) {
+    p->distance = distance;
+    p->v_max = v_max;
+    p->v_end = v_end;
+    p->accel = Params_Real(PARAM_ACCEL);
+    p->decel = Params_Real(PARAM_DECEL);
+    p->jerk = REAL(PROFILE_JERK);
+    p->vel = v_start;
+    p->acc = 0;
+}
+
+/**
+ * Distance needed to slow from the current speed to v_end. With a jerk limit
+ * any acceleration still in progress has to unwind first (raising the speed a
+ * little more), and the deceleration takes decel / jerk to build up; both are
+ * added on top of the constant-deceleration distance.
+ * Squares of speeds overflow Q16.16, so products go through r_muldiv.
+ */
+static real_t braking_distance(const Profile *p) {
+    real_t v = p->vel;
+    real_t d = 0;
+    if (p->jerk > 0) {
+        if (p->acc > 0) {
+            d += r_muldiv(v, p->acc, p->jerk);
+            v += r_muldiv(p->acc, p->acc, p->jerk) / 2;
+        }
+        d += r_muldiv(v, p->decel, p->jerk) / 2;
+    }
+    if (v <= p->v_end) return 0;
+    return d + r_muldiv(v - p->v_end, v + p->v_end, p->decel) / 2;
+}
+
+/**
+ * The profile is replanned every tick from the measured distance, so wheel lag
+ * or a lowered v_max never makes it overshoot the braking point. Near the end a
+ * segment stopping at zero keeps crawling at PROFILE_V_CREEP until the caller
+ * sees the distance covered. The period is passed as a rate: 1 ms is not exact in Q16.16.
+ */
+real_t Profile_Step(Profile *p, real_t travelled, int rate_hz) {
+    real_t remaining = p->distance - travelled;
+    real_t v_floor = r_max(p->v_end, REAL(PROFILE_V_CREEP));
+    bool braking = remaining <= braking_distance(p);
+    real_t a_target;
+
+    if (braking || p->vel > p->v_max) {
+        real_t target = braking ? p->v_end : p->v_max;
+        a_target = -p->decel;
+        // Ease the deceleration out so the speed lands on the target without a jerk
+        if (p->jerk > 0) a_target = -r_min(p->decel, r_sqrt_mul(p->jerk, 2 * r_max(p->vel - target, 0)));
+    } else {
+        a_target = p->accel;
+        // Same near the cruise speed: only accelerate as hard as can be ramped back to zero
+        if (p->jerk > 0) a_target = r_min(p->accel, r_sqrt_mul(p->jerk, 2 * r_max(p->v_max - p->vel, 0)));
+    }
+
+    if (p->jerk > 0) {
+        real_t da = p->jerk / rate_hz;
+        p->acc += r_clamp(a_target - p->acc, -da, da);
+    } else {
+        p->acc = a_target;
+    }
+
+    p->vel += p->acc / rate_hz;
+    if (remaining > 0 && p->vel < v_floor && p->acc <= 0) {
+        p->vel = r_min(v_floor, p->v_max);
+        p->acc = 0;
+    }
+    if (p->vel < 0) p->vel = 0;
+    return p->vel;
+}
@@ -0,0 +1,74 @@
+#include "telemetry.h"
+
+#define RING_MASK   (TELEMETRY_RECORDS - 1)
+#define TX_TIMEOUT  1000
+
+_Static_assert((TELEMETRY_RECORDS & RING_MASK) == 0, "TELEMETRY_RECORDS must be a power of two");
+
+static UART_HandleTypeDef *huart;
+static TelemetryRecord ring[TELEMETRY_RECORDS];
+static volatile uint32_t written;   // Records ever written since the start; the ring keeps the last ones
+static volatile bool recording;
+static uint32_t skipped;            // Control ticks since the last record
+
+void Telemetry_Init(UART_HandleTypeDef *uart) {
+    huart = uart;
+}
+
+void Telemetry_Start(void) {
+    recording = false;
+    written = 0;
+    skipped = TELEMETRY_DECIMATE - 1;   // Record the first tick
+    recording = true;
+}
+
+void Telemetry_Stop(void) {
+    recording = false;
+}
+
+TelemetryRecord *Telemetry_Slot(void) {
+    if (!recording || ++skipped < TELEMETRY_DECIMATE) return NULL;
+    skipped = 0;
+    return &ring[written++ & RING_MASK];
+}
+
+static void fletcher16(uint16_t *sum, const uint8_t *data, uint32_t len) {
+    uint16_t a = *sum & 0xFF, b = *sum >> 8;
+    while (len--) {
+        a = (uint16_t)((a + *data++) % 255);
+        b = (uint16_t)((b + a) % 255);
+    }
+    *sum = (uint16_t)(b << 8 | a);
+}
+
+static void send(const void *data, uint32_t len, uint16_t *sum) {
+    const uint8_t *p = data;
+    if (sum) fletcher16(sum, p, len);
+
+    // HAL transfers are limited to 64 KiB
+    while (len) {
+        uint16_t chunk = (len > 0x8000) ? 0x8000 : (uint16_t)len;
+        HAL_UART_Transmit(huart, (uint8_t *)p, chunk, TX_TIMEOUT);
+        p += chunk;
+        len -= chunk;
+    }
+}
+
+void Telemetry_Dump(void) {
+    if (!huart) return;
+
+    uint32_t count = (written < TELEMETRY_RECORDS) ? written : TELEMETRY_RECORDS;
+    uint32_t first = (written - count) & RING_MASK;
+    TelemetryHeader header = { TELEMETRY_MAGIC, (uint16_t)count, sizeof(TelemetryRecord) };
+    uint16_t sum = 0;
+
+    send(&header, sizeof(header), NULL);
+
+    // Oldest first: from the oldest slot to the end of the array, then the wrapped part
+    uint32_t tail = TELEMETRY_RECORDS - first;
+    if (tail > count) tail = count;
+    send(&ring[first], tail * sizeof(TelemetryRecord), &sum);
+    if (count > tail) send(&ring[0], (count - tail) * sizeof(TelemetryRecord), &sum);
+
+    send(&sum, sizeof(sum), NULL);
+}
@@ -0,0 +1,39 @@
+#include "timebase.h"
+
+static uint32_t cycles_per_us;
+static uint32_t last_cycles;    // CYCCNT at the previous update
+static uint32_t remainder;      // Cycles not yet worth a whole microsecond
+static uint32_t now_us;
+
+void Timebase_Init(void) {
+    cycles_per_us = SystemCoreClock / 1000000;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    last_cycles = 0;
+    remainder = 0;
+    now_us = 0;
+}
+
+/* Extends CYCCNT into a microsecond count; called from thread and interrupts alike */
+uint32_t Timebase_Us(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t cycles = DWT->CYCCNT;
+    uint32_t elapsed = cycles - last_cycles + remainder;
+    last_cycles = cycles;
+    now_us += elapsed / cycles_per_us;
+    remainder = elapsed % cycles_per_us;
+    uint32_t us = now_us;
+
+    if (!primask) __enable_irq();
+    return us;
+}
+
+void Timebase_DelayUs(uint32_t us) {
+    uint32_t start = Timebase_Us();
+    while (Timebase_Since(start) < us) {}
+}
@@ -1,21 +1,28 @@
 #include "vl6180x.h"
+#include "i2cbus.h"
+#include "timebase.h"
+#include "perf.h"
 #include "main.h"
 #include "stdio.h"
 #include "string.h"
 
-uint8_t VL6180X_ReadRegister(VL6180X *dev, uint16_t reg) {
-    uint8_t tx[2] = { reg >> 8, reg & 0xFF };
-    uint8_t rx;
+#define SYSRANGE_START                  0x0018
+#define SYSRANGE_INTERMEASUREMENT       0x001B
+#define SYSTEM_INTERRUPT_CONFIG_GPIO    0x0014
+#define SYSTEM_INTERRUPT_CLEAR          0x0015
+#define RESULT_INTERRUPT_STATUS_GPIO    0x004F
+#define RESULT_RANGE_VAL                0x0062
 
-    HAL_I2C_Master_Transmit(dev->hi2c, dev->address, tx, 2, HAL_MAX_DELAY);
-    HAL_I2C_Master_Receive(dev->hi2c, dev->address, &rx, 1, HAL_MAX_DELAY);
+#define RANGE_NEW_SAMPLE_READY          0x04
 
+uint8_t VL6180X_ReadRegister(VL6180X *dev, uint16_t reg) {
+    uint8_t rx = 0;
+    I2CBus_ReadSync(I2C_PRIO_RANGE, dev->address, reg, 2, &rx, 1);
     return rx;
 }
 
 HAL_StatusTypeDef VL6180X_WriteRegister(VL6180X *dev, uint16_t reg, uint8_t value) {
-    uint8_t data[3] = { reg >> 8, reg & 0xFF, value };
-    return HAL_I2C_Master_Transmit(dev->hi2c, dev->address, data, 3, HAL_MAX_DELAY);
+    return I2CBus_WriteSync(I2C_PRIO_RANGE, dev->address, reg, 2, &value, 1);
 }
 
 uint8_t VL6180X_Init(VL6180X *dev, I2C_HandleTypeDef *hi2c, uint8_t address) {
@@ -61,13 +68,21 @@ uint8_t VL6180X_Init(VL6180X *dev, I2C_HandleTypeDef *hi2c, uint8_t address) {
 }
 
 uint8_t VL6180X_ReadRange(VL6180X *dev) {
-    VL6180X_WriteRegister(dev, 0x0018, 0x01); // SYSRANGE_START
-    HAL_Delay(10);
-    if (VL6180X_ReadRegister(dev, 0x0062) >= 255){
-        return 0xB4;
+    uint32_t t0 = Perf_Begin();
+    uint8_t range;
+
+    if (dev->continuous) {
+        VL6180X_Poll(dev);
+        range = dev->range;
     } else {
-        return VL6180X_ReadRegister(dev, 0x0062);
+        VL6180X_WriteRegister(dev, SYSRANGE_START, 0x01);
+        HAL_Delay(10);
+        range = VL6180X_ReadRegister(dev, 0x0062);
+        if (range >= 255) range = 0xB4;
     }
+
+    Perf_End(PERF_TOF_READ, t0);
+    return range;
 }
 
 uint8_t VL6180X_ReadAverage(VL6180X *dev, uint8_t samples) {
@@ -82,10 +97,70 @@ uint8_t VL6180X_ReadAverage(VL6180X *dev, uint8_t samples) {
 void VL6180X_SetI2CAddress(VL6180X *dev, uint8_t new_address)
 {
     uint8_t data = new_address >> 1;  // 7-bit address
-    HAL_I2C_Mem_Write(dev->hi2c, dev->address, 0x212, 2, &data, 1, 100);
+    I2CBus_WriteSync(I2C_PRIO_RANGE, dev->address, 0x212, 2, &data, 1);
     dev->address = new_address;
 }
 
+// ===== Continuous ranging =====
+
+void VL6180X_StartContinuous(VL6180X *dev, uint8_t period_ms) {
+    uint8_t steps = (period_ms < 10) ? 0 : (uint8_t)(period_ms / 10 - 1);
+
+    VL6180X_WriteRegister(dev, SYSRANGE_INTERMEASUREMENT, steps);
+    VL6180X_WriteRegister(dev, SYSTEM_INTERRUPT_CONFIG_GPIO, RANGE_NEW_SAMPLE_READY);
+    VL6180X_WriteRegister(dev, SYSTEM_INTERRUPT_CLEAR, 0x07);
+    VL6180X_WriteRegister(dev, SYSRANGE_START, 0x03); // Start, continuous mode
+
+    dev->continuous = true;
+    dev->period_ms = (uint8_t)((steps + 1) * 10);
+    dev->sample_us = Timebase_Us();
+}
+
+void VL6180X_StopContinuous(VL6180X *dev) {
+    VL6180X_WriteRegister(dev, SYSRANGE_START, 0x01); // Start/stop toggles the running mode
+    VL6180X_WriteRegister(dev, SYSTEM_INTERRUPT_CLEAR, 0x07);
+    dev->continuous = false;
+}
+
+// Poll chain: status -> range -> interrupt clear, each step queued from the
+// previous one's completion callback. dev->busy covers the whole chain.
+static void poll_cleared(void *ctx, HAL_StatusTypeDef status) {
+    (void)status;
+    ((VL6180X *)ctx)->busy = false;
+}
+
+static void poll_range_read(void *ctx, HAL_StatusTypeDef status) {
+    static const uint8_t clear = 0x07;
+    VL6180X *dev = ctx;
+
+    if (status == HAL_OK) {
+        dev->range = (dev->rx >= 255) ? 0xB4 : dev->rx;
+        dev->samples++;
+        dev->sample_us = Timebase_Us();
+    }
+    if (!I2CBus_Write(I2C_PRIO_RANGE, dev->address, SYSTEM_INTERRUPT_CLEAR, 2, &clear, 1, poll_cleared, dev))
+        dev->busy = false;
+}
+
+static void poll_status_read(void *ctx, HAL_StatusTypeDef status) {
+    VL6180X *dev = ctx;
+
+    if (status != HAL_OK || (dev->rx & 0x07) != RANGE_NEW_SAMPLE_READY
+        || !I2CBus_Read(I2C_PRIO_RANGE, dev->address, RESULT_RANGE_VAL, 2, &dev->rx, 1, poll_range_read, dev))
+        dev->busy = false;
+}
+
+void VL6180X_Poll(VL6180X *dev) {
+    if (!dev->continuous || dev->busy) return;
+
+    // A result cannot be ready before the period is nearly over; skip the bus until then
+    if (Timebase_Since(dev->sample_us) + 1000 < dev->period_ms * 1000u) return;
+
+    dev->busy = true;
+    if (!I2CBus_Read(I2C_PRIO_RANGE, dev->address, RESULT_INTERRUPT_STATUS_GPIO, 2, &dev->rx, 1, poll_status_read, dev))
+        dev->busy = false;
+}
+
 float VL6180X_ReadFilteredRange(VL6180X *dev, float alpha) {
     uint8_t raw = VL6180X_ReadRange(dev);
     float filtered = alpha * raw + (1.0f - alpha) * dev->smoothedRange;
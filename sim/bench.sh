@@ -0,0 +1,42 @@
+#!/bin/sh
+# Runs the search in every maze of the corpus and tabulates the results.
+#   ./bench.sh [mousesim options]       e.g. ./bench.sh --search 1
+# With --speedrun the robot then drives the route itself: drv_s is its time,
+# off_mm the farthest it crossed a cell edge from the edge's midpoint.
+# MAZES overrides the corpus (default: mazes/*). Contest mazes in the text
+# drawing or the 256-byte .maz format can be dropped into mazes/ as they are.
+#
+# The bundled corpus, all 13/13 solved (mean search / speed run estimate, s):
+#   (default)               176.70 / 41.80      --turn 1                119.94 / 41.80
+#   --search 1              158.30 / 41.80      --turn 1 --search 1     101.11 / 41.80
+# and driven speed runs (mean drv_s): --speedrun 49.90, with --turn 1 30.68,
+# with --turn 2 31.61. The runner exits non-zero when any maze fails.
+
+cd "$(dirname "$0")" || exit 2
+SIM=./build/mousesim
+[ -x "$SIM" ] || make -s || exit 2
+
+printf '%-18s %-28s %7s %5s %5s %5s %5s | %5s %5s %7s | %5s %5s %7s | %7s %6s\n' \
+    maze result search cells moves goal turns \
+    run turns est_s best turns est_s drv_s off_mm
+
+for maze in ${MAZES:-mazes/*}; do
+    "$SIM" --bench --maze "$maze" "$@"
+done | awk -F '\t' '
+    {
+        printf "%-18s %-28s %7.2f %5d %5d %5d %5d | %5d %5d %7.2f | %5d %5d %7.2f | ", \
+               $1, $2, $3, $4, $5, $6, $7, $8, $9, $10, $11, $12, $13
+        if ($14 < 0) printf "%7s %6s\n", "-", "-"
+        else printf "%7.2f %6d\n", $14, $15
+        n++
+        if ($2 == "ok") { ok++; search += $3; est += $10; best += $13 }
+        if ($14 >= 0) { drove++; drive += $14 }
+    }
+    END {
+        printf "%d/%d mazes solved", ok, n
+        if (ok) printf ", mean search %.2f s, mean speed run %.2f s (%.2f s with the whole maze known)", \
+                       search / ok, est / ok, best / ok
+        if (drove) printf ", driven %.2f s", drive / drove
+        printf "\n"
+        exit ok != n
+    }'
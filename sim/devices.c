@@ -0,0 +1,255 @@
+#include "sim.h"
+#include <math.h>
+#include <string.h>
+
+int sim_tof_override_mm[SIM_TOF_COUNT] = { -1, -1, -1 };
+
+static uint32_t rng;
+
+/* ===== VL6180X: three modules, all at 0x29 until each is moved out of reset ===== */
+#define VL_DEFAULT_ADDR          0x29
+#define VL_MODEL_ID              0x000
+#define VL_FRESH_OUT_OF_RESET    0x016
+#define VL_INTERRUPT_CLEAR       0x015
+#define VL_SYSRANGE_START        0x018
+#define VL_INTERMEASUREMENT      0x01B
+#define VL_RESULT_INT_STATUS     0x04F
+#define VL_RESULT_RANGE_VAL      0x062
+#define VL_SLAVE_ADDR            0x212
+#define VL_CONVERSION_US         8000   // Single-shot ranging time
+#define VL_NEW_SAMPLE_READY      0x04
+
+typedef struct {
+    GPIO_TypeDef *xshut_port;
+    uint16_t xshut_pin;
+    int sensor;
+    bool on;
+    uint8_t addr7;
+    uint16_t index;
+    uint8_t steps;              // SYSRANGE_INTERMEASUREMENT
+    bool continuous;
+    uint64_t start_us;
+    uint32_t period_us;
+    uint32_t consumed;          // Continuous samples already cleared
+    bool single_pending;
+    uint64_t single_ready_us;
+} Tof;
+
+static Tof tofs[SIM_TOF_COUNT] = {
+    { XSHUT_LEFT_PORT,  XSHUT_LEFT_PIN,  SIM_TOF_LEFT,  false, VL_DEFAULT_ADDR, 0, 0, false, 0, 0, 0, false, 0 },
+    { XSHUT_FRONT_PORT, XSHUT_FRONT_PIN, SIM_TOF_FRONT, false, VL_DEFAULT_ADDR, 0, 0, false, 0, 0, 0, false, 0 },
+    { XSHUT_RIGHT_PORT, XSHUT_RIGHT_PIN, SIM_TOF_RIGHT, false, VL_DEFAULT_ADDR, 0, 0, false, 0, 0, 0, false, 0 },
+};
+
+// XSHUT low holds the module in reset, forgetting its address
+static void tof_power(Tof *t) {
+    if (sim_get_pin(t->xshut_port, t->xshut_pin)) {
+        t->on = true;
+        return;
+    }
+    t->on = false;
+    t->addr7 = VL_DEFAULT_ADDR;
+    t->continuous = false;
+    t->single_pending = false;
+}
+
+static uint32_t tof_ready_count(const Tof *t) {
+    return (uint32_t)((sim_now_us() - t->start_us) / t->period_us);
+}
+
+static uint8_t tof_range(const Tof *t) {
+    double mm = (sim_tof_override_mm[t->sensor] >= 0) ? sim_tof_override_mm[t->sensor] : robot_tof_mm(t->sensor);
+    if (mm >= SIM_TOF_MAX_MM) return 255;
+    return (uint8_t)lround(fmax(mm, 0.0));
+}
+
+static void tof_write_reg(Tof *t, uint16_t reg, uint8_t value) {
+    switch (reg) {
+        case VL_SLAVE_ADDR:
+            t->addr7 = value & 0x7F;
+            break;
+        case VL_INTERMEASUREMENT:
+            t->steps = value;
+            break;
+        case VL_SYSRANGE_START:
+            if (value & 0x02) {
+                t->continuous = true;
+                t->start_us = sim_now_us();
+                t->period_us = (t->steps + 1u) * 10000u;
+                t->consumed = 0;
+            } else if (value & 0x01) {
+                if (t->continuous) {
+                    t->continuous = false;
+                } else {
+                    t->single_pending = true;
+                    t->single_ready_us = sim_now_us() + VL_CONVERSION_US;
+                }
+            }
+            break;
+        case VL_INTERRUPT_CLEAR:
+            if (t->continuous) t->consumed = tof_ready_count(t);
+            else t->single_pending = false;
+            break;
+        default:
+            break;
+    }
+}
+
+static uint8_t tof_read_reg(Tof *t, uint16_t reg) {
+    switch (reg) {
+        case VL_MODEL_ID:
+            return 0xB4;
+        case VL_FRESH_OUT_OF_RESET:
+            return 1;
+        case VL_RESULT_INT_STATUS:
+            if (t->continuous) return (tof_ready_count(t) > t->consumed) ? VL_NEW_SAMPLE_READY : 0;
+            return (t->single_pending && sim_now_us() >= t->single_ready_us) ? VL_NEW_SAMPLE_READY : 0;
+        case VL_RESULT_RANGE_VAL:
+            return tof_range(t);
+        default:
+            return 0;
+    }
+}
+
+/* ===== MPU6050: gyro Z through the output registers and the FIFO ===== */
+#define MPU_ADDR7        0x68
+#define MPU_SMPLRT_DIV   0x19
+#define MPU_CONFIG       0x1A
+#define MPU_GYRO_CONFIG  0x1B
+#define MPU_FIFO_EN      0x23
+#define MPU_GYRO_ZOUT_H  0x47
+#define MPU_USER_CTRL    0x6A
+#define MPU_PWR_MGMT_1   0x6B
+#define MPU_FIFO_COUNT_H 0x72
+#define MPU_FIFO_R_W     0x74
+#define MPU_WHO_AM_I     0x75
+#define MPU_FIFO_SIZE    1024
+#define MPU_NOISE_LSB    2.0
+
+static struct {
+    uint8_t regs[128];
+    uint8_t index;
+    uint8_t fifo[MPU_FIFO_SIZE];
+    uint16_t fifo_head, fifo_count;
+    uint64_t next_sample_us;
+    double filtered_dps;
+    double bias_lsb;
+} mpu;
+
+static void mpu_fifo_push(uint8_t b) {
+    if (mpu.fifo_count == MPU_FIFO_SIZE) {
+        // Full: the oldest byte is overwritten
+        mpu.fifo_head = (mpu.fifo_head + 1) % MPU_FIFO_SIZE;
+        mpu.fifo_count--;
+    }
+    mpu.fifo[(mpu.fifo_head + mpu.fifo_count) % MPU_FIFO_SIZE] = b;
+    mpu.fifo_count++;
+}
+
+static void mpu_sample(uint32_t period_us) {
+    // DLPF as a single pole at the configured bandwidth
+    static const double BANDWIDTH_HZ[8] = { 256, 188, 98, 42, 20, 10, 5, 256 };
+    double tau = 1.0 / (2 * M_PI * BANDWIDTH_HZ[mpu.regs[MPU_CONFIG] & 7]);
+    double dt = period_us * 1e-6;
+    mpu.filtered_dps += (robot_yaw_rate_dps() - mpu.filtered_dps) * dt / (tau + dt);
+
+    double sens = 131.0 / (1 << ((mpu.regs[MPU_GYRO_CONFIG] >> 3) & 3));
+    double raw = mpu.filtered_dps * sens + mpu.bias_lsb + MPU_NOISE_LSB * sim_gauss(&rng);
+    int16_t gz = (int16_t)fmax(fmin(lround(raw), 32767), -32768);
+
+    mpu.regs[MPU_GYRO_ZOUT_H] = (uint8_t)((uint16_t)gz >> 8);
+    mpu.regs[MPU_GYRO_ZOUT_H + 1] = (uint8_t)gz;
+    if ((mpu.regs[MPU_USER_CTRL] & 0x40) && (mpu.regs[MPU_FIFO_EN] & 0x10)) {
+        mpu_fifo_push(mpu.regs[MPU_GYRO_ZOUT_H]);
+        mpu_fifo_push(mpu.regs[MPU_GYRO_ZOUT_H + 1]);
+    }
+}
+
+static void mpu_write_reg(uint8_t reg, uint8_t value) {
+    if (reg == MPU_FIFO_R_W || reg == MPU_WHO_AM_I) return;
+    if (reg == MPU_USER_CTRL && (value & 0x04)) {
+        mpu.fifo_head = mpu.fifo_count = 0;
+        value &= (uint8_t)~0x04;
+    }
+    mpu.regs[reg & 0x7F] = value;
+}
+
+static uint8_t mpu_read_reg(uint8_t reg) {
+    if (reg == MPU_FIFO_COUNT_H) return (uint8_t)(mpu.fifo_count >> 8);
+    if (reg == MPU_FIFO_COUNT_H + 1) return (uint8_t)mpu.fifo_count;
+    return mpu.regs[reg & 0x7F];
+}
+
+/* ===== SSD1306: acknowledged and ignored ===== */
+#define OLED_ADDR7       0x3C
+
+/* ===== Bus ===== */
+void devices_reset(uint32_t seed) {
+    rng = seed * 2891336453u + 7;
+    memset(&mpu, 0, sizeof(mpu));
+    mpu.regs[MPU_PWR_MGMT_1] = 0x40;    // Asleep out of reset
+    mpu.regs[MPU_WHO_AM_I] = MPU_ADDR7;
+    mpu.bias_lsb = 15.0 * sim_gauss(&rng);
+}
+
+void devices_step(uint64_t now_us) {
+    if (mpu.regs[MPU_PWR_MGMT_1] & 0x40) {
+        mpu.next_sample_us = now_us;
+        return;
+    }
+    uint8_t dlpf = mpu.regs[MPU_CONFIG] & 7;
+    uint32_t period_us = ((dlpf == 0 || dlpf == 7) ? 125u : 1000u) * (1u + mpu.regs[MPU_SMPLRT_DIV]);
+    while (now_us >= mpu.next_sample_us) {
+        mpu_sample(period_us);
+        mpu.next_sample_us += period_us;
+    }
+}
+
+static Tof *tof_at(uint8_t addr7) {
+    for (int i = 0; i < SIM_TOF_COUNT; i++) {
+        tof_power(&tofs[i]);
+        if (tofs[i].on && tofs[i].addr7 == addr7) return &tofs[i];
+    }
+    return NULL;
+}
+
+bool devices_write(uint8_t addr7, const uint8_t *data, uint16_t len) {
+    if (addr7 == MPU_ADDR7) {
+        if (len == 0) return true;
+        mpu.index = data[0];
+        for (uint16_t i = 1; i < len; i++) mpu_write_reg(mpu.index++, data[i]);
+        return true;
+    }
+    if (addr7 == OLED_ADDR7) return true;
+
+    Tof *t = tof_at(addr7);
+    if (!t) return false;
+    if (len < 2) return true;
+    t->index = (uint16_t)(data[0] << 8 | data[1]);
+    for (uint16_t i = 2; i < len; i++) tof_write_reg(t, t->index++, data[i]);
+    return true;
+}
+
+bool devices_read(uint8_t addr7, uint8_t *data, uint16_t len) {
+    if (addr7 == MPU_ADDR7) {
+        for (uint16_t i = 0; i < len; i++) {
+            if (mpu.index == MPU_FIFO_R_W) {
+                // Burst reads of FIFO_R_W keep popping the FIFO
+                data[i] = mpu.fifo_count ? mpu.fifo[mpu.fifo_head] : 0;
+                if (mpu.fifo_count) {
+                    mpu.fifo_head = (mpu.fifo_head + 1) % MPU_FIFO_SIZE;
+                    mpu.fifo_count--;
+                }
+            } else {
+                data[i] = mpu_read_reg(mpu.index++);
+            }
+        }
+        return true;
+    }
+    if (addr7 == OLED_ADDR7) return false;
+
+    Tof *t = tof_at(addr7);
+    if (!t) return false;
+    for (uint16_t i = 0; i < len; i++) data[i] = tof_read_reg(t, t->index++);
+    return true;
+}
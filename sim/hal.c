@@ -0,0 +1,495 @@
+#include "sim.h"
+#include "main.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+/* ===== Peripheral memory ===== */
+GPIO_TypeDef sim_gpioa, sim_gpiob, sim_gpioc;
+TIM_TypeDef sim_tim1, sim_tim2, sim_tim3, sim_tim4;
+DWT_Type sim_dwt;
+CoreDebug_Type sim_core_debug;
+uint32_t sim_i2c1;
+uint32_t sim_usart1;
+FILE *sim_uart_out;
+uint32_t sim_uart_sent;
+uint32_t SystemCoreClock = SIM_CPU_HZ;
+
+/* ===== Scheduler state ===== */
+static uint64_t now_us;
+static uint32_t primask;
+static int isr_depth;               // Nonzero while a simulated interrupt runs
+static uint64_t next_phys_us;
+
+typedef struct {
+    TIM_HandleTypeDef *h;
+    bool running;
+    uint64_t next_us;
+} SimTimer;
+
+static SimTimer timers[2];          // TIM1 (buzzer), TIM3 (control tick)
+
+typedef enum { XFER_TX, XFER_RX, XFER_MEM_TX, XFER_MEM_RX } XferKind;
+
+typedef struct {
+    bool active;
+    uint64_t done_us;
+    I2C_HandleTypeDef *h;
+    XferKind kind;
+    uint8_t addr7;
+    uint16_t reg;
+    uint8_t reg_bytes;
+    uint8_t *data;
+    uint16_t len;
+} SimXfer;
+
+static SimXfer xfer;
+
+// Console input, one byte per 10 bit times while a receive is armed
+static struct {
+    UART_HandleTypeDef *h;
+    uint8_t *dst;
+    uint16_t left;          // Bytes until the armed receive completes
+    const uint8_t *data;
+    size_t len, pos;
+    uint64_t next_us;
+} rx;
+
+#define RX_BYTE_US  (10 * 1000000u / TELEMETRY_BAUD)
+
+// EXTI lines armed by HAL_GPIO_Init, per port
+static uint16_t exti_a, exti_b, exti_c;
+static uint32_t pin_reads[3][16];
+
+uint64_t sim_now_us(void) { return now_us; }
+
+static void set_clock(uint64_t t) {
+    if (DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)
+        DWT->CYCCNT += (uint32_t)((t - now_us) * (SIM_CPU_HZ / 1000000u));
+    now_us = t;
+}
+
+static SimTimer *timer_of(TIM_TypeDef *t) {
+    if (t == TIM1) return &timers[0];
+    if (t == TIM3) return &timers[1];
+    return NULL;
+}
+
+static uint64_t timer_period_us(TIM_TypeDef *t) {
+    uint64_t cycles = (uint64_t)(t->PSC + 1) * (t->ARR + 1);
+    uint64_t us = cycles / (SIM_CPU_HZ / 1000000u);
+    return us ? us : 1;
+}
+
+static void i2c_complete(void);
+static void uart_rx_byte(void);
+
+/* Earliest pending interrupt; physics counts as one so the robot keeps moving */
+static uint64_t next_event_us(int *which) {
+    uint64_t t = next_phys_us;
+    *which = 0;
+    for (int i = 0; i < 2; i++) {
+        if (timers[i].running && timers[i].next_us < t) {
+            t = timers[i].next_us;
+            *which = 1 + i;
+        }
+    }
+    if (xfer.active && xfer.done_us < t) {
+        t = xfer.done_us;
+        *which = 3;
+    }
+    if (rx.left && rx.pos < rx.len && rx.next_us < t) {
+        t = rx.next_us;
+        *which = 4;
+    }
+    return t;
+}
+
+static void run_until(uint64_t target) {
+    for (;;) {
+        int which;
+        uint64_t t = next_event_us(&which);
+        if (t > target) break;
+        set_clock(t);
+
+        isr_depth++;
+        if (which == 0) {
+            next_phys_us += SIM_PHYS_US;
+            robot_step(SIM_PHYS_US * 1e-6);
+            devices_step(now_us);
+        } else if (which == 3) {
+            i2c_complete();
+        } else if (which == 4) {
+            uart_rx_byte();
+        } else {
+            SimTimer *tm = &timers[which - 1];
+            HAL_TIM_PeriodElapsedCallback(tm->h);
+            // The callback may have changed ARR or stopped the timer
+            tm->next_us = now_us + timer_period_us(tm->h->Instance);
+        }
+        isr_depth--;
+    }
+    set_clock(target);
+}
+
+void sim_access(void) {
+    if (isr_depth || primask) return;
+    run_until(now_us + SIM_ACCESS_US);
+    sim_thread_point();
+}
+
+// Thread code busy on a slow peripheral: interrupts keep running meanwhile
+static void stall(uint64_t us) {
+    if (isr_depth || primask) return;
+    run_until(now_us + us);
+    sim_thread_point();
+}
+
+void sim_wait_event(void) {
+    if (isr_depth || primask) return;
+    int which;
+    uint64_t t = next_event_us(&which);
+    run_until(t > now_us ? t : now_us + 1);
+    sim_thread_point();
+}
+
+/* ===== Core ===== */
+uint32_t __get_PRIMASK(void) {
+    sim_access();
+    return primask;
+}
+
+uint32_t sim_primask(void) { return primask; }
+
+void __disable_irq(void) { primask = 1; }
+void __enable_irq(void)  { primask = 0; }
+void __WFI(void)         { sim_wait_event(); }
+
+/* ===== GPIO ===== */
+static uint16_t *exti_of(GPIO_TypeDef *port) {
+    return (port == GPIOA) ? &exti_a : (port == GPIOB) ? &exti_b : &exti_c;
+}
+
+void sim_set_pin(GPIO_TypeDef *port, uint16_t pin, bool level) {
+    if (level) port->IDR |= pin;
+    else port->IDR &= ~(uint32_t)pin;
+}
+
+bool sim_get_pin(GPIO_TypeDef *port, uint16_t pin) {
+    return (port->ODR & pin) != 0;
+}
+
+static int port_index(GPIO_TypeDef *port) {
+    return (port == GPIOA) ? 0 : (port == GPIOB) ? 1 : 2;
+}
+
+uint32_t sim_pin_reads(GPIO_TypeDef *port, uint16_t pin) {
+    return pin_reads[port_index(port)][__builtin_ctz(pin)];
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef *port, GPIO_InitTypeDef *init) {
+    if (init->Mode & 0x10000000u) *exti_of(port) |= (uint16_t)init->Pin;
+    if (init->Mode == GPIO_MODE_INPUT && init->Pull == GPIO_PULLUP) port->IDR |= init->Pin;
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *port, uint16_t pin) {
+    pin_reads[port_index(port)][__builtin_ctz(pin)]++;
+    sim_access();
+    return (port->IDR & pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state) {
+    if (state == GPIO_PIN_SET) port->ODR |= pin;
+    else port->ODR &= ~(uint32_t)pin;
+    sim_set_pin(port, pin, state == GPIO_PIN_SET);
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *port, uint16_t pin) {
+    HAL_GPIO_WritePin(port, pin, (port->ODR & pin) ? GPIO_PIN_RESET : GPIO_PIN_SET);
+}
+
+/* ===== Encoders: quadrature edges on the EXTI pins, one interrupt each ===== */
+static const struct {
+    GPIO_TypeDef *a_port;
+    uint16_t a_pin;
+    GPIO_TypeDef *b_port;
+    uint16_t b_pin;
+} ENC[2] = {
+    { GPIOB, GPIO_PIN_11, GPIOB, GPIO_PIN_10 },     // Left
+    { GPIOA, GPIO_PIN_8,  GPIOB, GPIO_PIN_15 },     // Right
+};
+
+static const uint8_t GRAY[4] = { 0, 1, 3, 2 };      // (A << 1) | B going forward: B leads A
+static int32_t enc_count[2];
+
+static void edge(GPIO_TypeDef *port, uint16_t pin, bool level) {
+    sim_set_pin(port, pin, level);
+    if (*exti_of(port) & pin) HAL_GPIO_EXTI_Callback(pin);
+}
+
+void sim_encoder_set(int side, int32_t count) {
+    while (enc_count[side] != count) {
+        enc_count[side] += (count > enc_count[side]) ? 1 : -1;
+        uint8_t s = GRAY[enc_count[side] & 3];
+        bool a = s >> 1, b = s & 1;
+        bool a_now = (ENC[side].a_port->IDR & ENC[side].a_pin) != 0;
+        if (a != a_now) edge(ENC[side].a_port, ENC[side].a_pin, a);
+        else edge(ENC[side].b_port, ENC[side].b_pin, b);
+    }
+}
+
+/* ===== Motors: DRV8833 inputs on TIM2 CH1/CH2 (left) and CH3/CH4 (right) ===== */
+int sim_motor_pwm(int side) {
+    uint32_t in1 = side ? TIM2->CCR3 : TIM2->CCR1;
+    uint32_t in2 = side ? TIM2->CCR4 : TIM2->CCR2;
+    uint32_t top = TIM2->ARR;
+    if (in1 >= top && in2 >= top) return 256;   // Both high: slow decay brake
+    return (int)in2 - (int)in1;
+}
+
+/* ===== RCC / system ===== */
+HAL_StatusTypeDef HAL_Init(void) { return HAL_OK; }
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *init) { (void)init; return HAL_OK; }
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *init, uint32_t latency) { (void)init; (void)latency; return HAL_OK; }
+
+uint32_t HAL_GetTick(void) {
+    sim_access();
+    return (uint32_t)(now_us / 1000);
+}
+
+void HAL_Delay(uint32_t ms) {
+    uint32_t start = HAL_GetTick();
+    uint32_t wait = ms;
+    if (wait < HAL_MAX_DELAY) wait++;
+    while (HAL_GetTick() - start < wait) sim_wait_event();
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t preempt, uint32_t sub) { (void)irq; (void)preempt; (void)sub; }
+void HAL_NVIC_EnableIRQ(IRQn_Type irq) { (void)irq; }
+void HAL_NVIC_DisableIRQ(IRQn_Type irq) { (void)irq; }
+
+/* ===== TIM ===== */
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *h) {
+    h->Instance->PSC = h->Init.Prescaler;
+    h->Instance->ARR = h->Init.Period;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Init(TIM_HandleTypeDef *h) { return HAL_TIM_Base_Init(h); }
+HAL_StatusTypeDef HAL_TIM_ConfigClockSource(TIM_HandleTypeDef *h, TIM_ClockConfigTypeDef *cfg) { (void)h; (void)cfg; return HAL_OK; }
+HAL_StatusTypeDef HAL_TIMEx_MasterConfigSynchronization(TIM_HandleTypeDef *h, TIM_MasterConfigTypeDef *cfg) { (void)h; (void)cfg; return HAL_OK; }
+
+HAL_StatusTypeDef HAL_TIM_PWM_ConfigChannel(TIM_HandleTypeDef *h, TIM_OC_InitTypeDef *cfg, uint32_t ch) {
+    __HAL_TIM_SET_COMPARE(h, ch, cfg->Pulse);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *h, uint32_t ch) { (void)h; (void)ch; return HAL_OK; }
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *h) {
+    SimTimer *tm = timer_of(h->Instance);
+    if (tm) {
+        tm->h = h;
+        tm->running = true;
+        tm->next_us = now_us + timer_period_us(h->Instance);
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *h) {
+    SimTimer *tm = timer_of(h->Instance);
+    if (tm) tm->running = false;
+    return HAL_OK;
+}
+
+void HAL_TIM_MspPostInit(TIM_HandleTypeDef *htim) { (void)htim; }
+
+/* ===== I2C: one transfer on the wire at a time, completed by interrupt ===== */
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *h) { (void)h; return HAL_OK; }
+
+static HAL_StatusTypeDef i2c_start(I2C_HandleTypeDef *h, XferKind kind, uint16_t addr,
+                                   uint16_t reg, uint16_t reg_size, uint8_t *data, uint16_t len) {
+    if (xfer.active) return HAL_BUSY;
+
+    uint8_t reg_bytes = (kind == XFER_MEM_TX || kind == XFER_MEM_RX) ? ((reg_size == I2C_MEMADD_SIZE_16BIT) ? 2 : 1) : 0;
+    // Address, register, repeated start for reads, data; 9 clocks a byte
+    uint32_t bytes = 1u + reg_bytes + (kind == XFER_MEM_RX ? 1u : 0u) + len;
+    uint32_t hz = h->Init.ClockSpeed ? h->Init.ClockSpeed : 100000u;
+
+    xfer = (SimXfer){
+        .active = true,
+        .done_us = now_us + 5 + (uint64_t)bytes * 9 * 1000000u / hz,
+        .h = h, .kind = kind, .addr7 = (uint8_t)(addr >> 1),
+        .reg = reg, .reg_bytes = reg_bytes, .data = data, .len = len,
+    };
+    return HAL_OK;
+}
+
+static void i2c_complete(void) {
+    static uint8_t wire[2 + 1024];
+    SimXfer x = xfer;
+    xfer.active = false;
+
+    bool ack;
+    switch (x.kind) {
+        case XFER_TX:
+            ack = devices_write(x.addr7, x.data, x.len);
+            break;
+        case XFER_RX:
+            ack = devices_read(x.addr7, x.data, x.len);
+            break;
+        case XFER_MEM_TX:
+        case XFER_MEM_RX: {
+            uint16_t n = 0;
+            if (x.reg_bytes == 2) wire[n++] = (uint8_t)(x.reg >> 8);
+            wire[n++] = (uint8_t)x.reg;
+            if (x.kind == XFER_MEM_TX) {
+                uint16_t len = (x.len > sizeof(wire) - n) ? (uint16_t)(sizeof(wire) - n) : x.len;
+                memcpy(&wire[n], x.data, len);
+                ack = devices_write(x.addr7, wire, (uint16_t)(n + len));
+            } else {
+                ack = devices_write(x.addr7, wire, n) && devices_read(x.addr7, x.data, x.len);
+            }
+            break;
+        }
+        default:
+            ack = false;
+            break;
+    }
+
+    if (!ack) {
+        x.h->ErrorCode = HAL_I2C_ERROR_AF;
+        HAL_I2C_ErrorCallback(x.h);
+        return;
+    }
+    x.h->ErrorCode = 0;
+    switch (x.kind) {
+        case XFER_TX:     HAL_I2C_MasterTxCpltCallback(x.h); break;
+        case XFER_RX:     HAL_I2C_MasterRxCpltCallback(x.h); break;
+        case XFER_MEM_TX: HAL_I2C_MemTxCpltCallback(x.h); break;
+        case XFER_MEM_RX: HAL_I2C_MemRxCpltCallback(x.h); break;
+    }
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_IT(I2C_HandleTypeDef *h, uint16_t addr, uint8_t *data, uint16_t len) {
+    return i2c_start(h, XFER_TX, addr, 0, 0, data, len);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Receive_IT(I2C_HandleTypeDef *h, uint16_t addr, uint8_t *data, uint16_t len) {
+    return i2c_start(h, XFER_RX, addr, 0, 0, data, len);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *h, uint16_t addr, uint16_t reg, uint16_t reg_size, uint8_t *data, uint16_t len) {
+    return i2c_start(h, XFER_MEM_RX, addr, reg, reg_size, data, len);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_IT(I2C_HandleTypeDef *h, uint16_t addr, uint16_t reg, uint16_t reg_size, uint8_t *data, uint16_t len) {
+    return i2c_start(h, XFER_MEM_TX, addr, reg, reg_size, data, len);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_DMA(I2C_HandleTypeDef *h, uint16_t addr, uint8_t *data, uint16_t len) {
+    return i2c_start(h, XFER_TX, addr, 0, 0, data, len);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef *h, uint16_t addr, uint16_t reg, uint16_t reg_size, uint8_t *data, uint16_t len) {
+    return i2c_start(h, XFER_MEM_TX, addr, reg, reg_size, data, len);
+}
+
+/* ===== UART: polled TX, 10 bit times per byte ===== */
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *h) { (void)h; return HAL_OK; }
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *h, const uint8_t *data, uint16_t len, uint32_t timeout) {
+    (void)timeout;
+    if (sim_uart_out) fwrite(data, 1, len, sim_uart_out);
+    sim_uart_sent += len;
+    stall((uint64_t)len * 10 * 1000000u / h->Init.BaudRate);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *h, uint8_t *data, uint16_t len) {
+    if (rx.left) return HAL_BUSY;
+    rx.h = h;
+    rx.dst = data;
+    rx.left = len;
+    return HAL_OK;
+}
+
+static void uart_rx_byte(void) {
+    *rx.dst++ = rx.data[rx.pos++];
+    rx.next_us += RX_BYTE_US;
+    if (--rx.left == 0) HAL_UART_RxCpltCallback(rx.h);
+}
+
+void sim_uart_type(const void *data, size_t len) {
+    rx.data = data;
+    rx.len = len;
+    rx.pos = 0;
+    rx.next_us = now_us + RX_BYTE_US;
+}
+
+bool sim_uart_typing(void) {
+    return rx.pos < rx.len;
+}
+
+/* ===== Flash: erase sets bits, programming only clears them, as on the chip ===== */
+#define SIM_FLASH_LEN   (PARAMS_FLASH_PAGES * FLASH_PAGE_SIZE)
+#define ERASE_US        20000
+#define HALFWORD_US     52
+
+static bool flash_locked = true;
+
+uint8_t *sim_flash(void) {
+    static uint8_t *flash;
+    if (flash) return flash;
+
+    // Host pages around the firmware's fixed address, so it reads flash through plain pointers
+    uintptr_t base = PARAMS_FLASH_ADDR & ~(uintptr_t)0xFFF;
+    size_t len = (PARAMS_FLASH_ADDR + SIM_FLASH_LEN - base + 0xFFF) & ~(size_t)0xFFF;
+    void *p = mmap((void *)base, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (p != (void *)base) {
+        fprintf(stderr, "cannot map the parameter flash at 0x%08X\n", PARAMS_FLASH_ADDR);
+        exit(2);
+    }
+    flash = (uint8_t *)(uintptr_t)PARAMS_FLASH_ADDR;
+    memset(flash, 0xFF, SIM_FLASH_LEN);
+    return flash;
+}
+
+static uint8_t *flash_at(uint32_t address, uint32_t len) {
+    if (address < PARAMS_FLASH_ADDR || address + len > PARAMS_FLASH_ADDR + SIM_FLASH_LEN) return NULL;
+    return sim_flash() + (address - PARAMS_FLASH_ADDR);
+}
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void) { flash_locked = false; return HAL_OK; }
+HAL_StatusTypeDef HAL_FLASH_Lock(void)   { flash_locked = true; return HAL_OK; }
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *init, uint32_t *page_error) {
+    *page_error = 0xFFFFFFFFu;
+    for (uint32_t i = 0; i < init->NbPages; i++) {
+        uint32_t address = init->PageAddress + i * FLASH_PAGE_SIZE;
+        uint8_t *page = flash_at(address, FLASH_PAGE_SIZE);
+        if (flash_locked || !page || (address % FLASH_PAGE_SIZE)) {
+            *page_error = address;
+            return HAL_ERROR;
+        }
+        memset(page, 0xFF, FLASH_PAGE_SIZE);
+        stall(ERASE_US);
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t type, uint32_t address, uint64_t data) {
+    int halfwords = (type == FLASH_TYPEPROGRAM_WORD) ? 2 : (type == FLASH_TYPEPROGRAM_HALFWORD) ? 1 : 4;
+    uint8_t *dst = flash_at(address, (uint32_t)halfwords * 2);
+    if (flash_locked || !dst || (address & 1)) return HAL_ERROR;
+
+    for (int i = 0; i < halfwords; i++, dst += 2, data >>= 16) {
+        uint16_t now, value = (uint16_t)data;
+        memcpy(&now, dst, 2);
+        // The chip refuses to program a halfword that is not erased, bar writing zero
+        if (now != 0xFFFF && value != 0) return HAL_ERROR;
+        memcpy(dst, &value, 2);
+        stall(HALFWORD_US);
+    }
+    return HAL_OK;
+}
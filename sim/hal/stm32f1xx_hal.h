@@ -0,0 +1,262 @@
+/*
+ * Host stand-in for the STM32F1 HAL: just the types, constants and calls the
+ * firmware uses. Peripherals are plain structs in sim memory; the functions
+ * live in hal.c and drive the simulated robot.
+ */
+#ifndef STM32F1XX_HAL_H
+#define STM32F1XX_HAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define __IO volatile
+
+typedef enum { HAL_OK = 0, HAL_ERROR, HAL_BUSY, HAL_TIMEOUT } HAL_StatusTypeDef;
+typedef enum { RESET = 0, SET = !RESET } FlagStatus;
+#define HAL_MAX_DELAY 0xFFFFFFFFu
+
+/* ===== Core ===== */
+typedef int IRQn_Type;
+#define EXTI9_5_IRQn          23
+#define I2C1_EV_IRQn          31
+#define I2C1_ER_IRQn          32
+#define EXTI15_10_IRQn        40
+#define TIM1_UP_IRQn          25
+#define TIM3_IRQn             29
+#define DMA1_Channel6_IRQn    16
+#define USART1_IRQn           37
+
+typedef struct { __IO uint32_t CTRL, CYCCNT; } DWT_Type;
+typedef struct { __IO uint32_t DEMCR; } CoreDebug_Type;
+extern DWT_Type sim_dwt;
+extern CoreDebug_Type sim_core_debug;
+#define DWT       (&sim_dwt)
+#define CoreDebug (&sim_core_debug)
+#define CoreDebug_DEMCR_TRCENA_Msk (1u << 24)
+#define DWT_CTRL_CYCCNTENA_Msk     (1u << 0)
+extern uint32_t SystemCoreClock;
+
+/* Interrupt masking is real: sim interrupts only fire while PRIMASK is clear */
+uint32_t __get_PRIMASK(void);
+uint32_t sim_primask(void);         // Without the thread-access cost, for perf.c's bookkeeping
+#define PERF_GET_PRIMASK()  sim_primask()
+void __disable_irq(void);
+void __enable_irq(void);
+void __WFI(void);
+#define __DMB() __sync_synchronize()
+
+/* ===== GPIO ===== */
+typedef enum { GPIO_PIN_RESET = 0, GPIO_PIN_SET } GPIO_PinState;
+typedef struct { __IO uint32_t CRL, CRH, IDR, ODR, BSRR, BRR, LCKR; } GPIO_TypeDef;
+typedef struct { uint32_t Pin, Mode, Pull, Speed; } GPIO_InitTypeDef;
+extern GPIO_TypeDef sim_gpioa, sim_gpiob, sim_gpioc;
+#define GPIOA (&sim_gpioa)
+#define GPIOB (&sim_gpiob)
+#define GPIOC (&sim_gpioc)
+
+#define GPIO_PIN_0  0x0001u
+#define GPIO_PIN_1  0x0002u
+#define GPIO_PIN_2  0x0004u
+#define GPIO_PIN_3  0x0008u
+#define GPIO_PIN_4  0x0010u
+#define GPIO_PIN_5  0x0020u
+#define GPIO_PIN_6  0x0040u
+#define GPIO_PIN_7  0x0080u
+#define GPIO_PIN_8  0x0100u
+#define GPIO_PIN_9  0x0200u
+#define GPIO_PIN_10 0x0400u
+#define GPIO_PIN_11 0x0800u
+#define GPIO_PIN_12 0x1000u
+#define GPIO_PIN_13 0x2000u
+#define GPIO_PIN_14 0x4000u
+#define GPIO_PIN_15 0x8000u
+
+#define GPIO_MODE_INPUT              0x00u
+#define GPIO_MODE_OUTPUT_PP          0x01u
+#define GPIO_MODE_OUTPUT_OD          0x11u
+#define GPIO_MODE_AF_PP              0x02u
+#define GPIO_MODE_AF_OD              0x12u
+#define GPIO_MODE_IT_RISING          0x10110000u
+#define GPIO_MODE_IT_FALLING         0x10210000u
+#define GPIO_MODE_IT_RISING_FALLING  0x10310000u
+#define GPIO_NOPULL                  0x0u
+#define GPIO_PULLUP                  0x1u
+#define GPIO_PULLDOWN                0x2u
+#define GPIO_SPEED_FREQ_LOW          0x2u
+#define GPIO_SPEED_FREQ_MEDIUM       0x1u
+#define GPIO_SPEED_FREQ_HIGH         0x3u
+
+void HAL_GPIO_Init(GPIO_TypeDef *port, GPIO_InitTypeDef *init);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *port, uint16_t pin);
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state);
+void HAL_GPIO_TogglePin(GPIO_TypeDef *port, uint16_t pin);
+void HAL_GPIO_EXTI_Callback(uint16_t pin);
+
+/* ===== RCC / system ===== */
+typedef struct { uint32_t PLLState, PLLSource, PLLMUL; } RCC_PLLInitTypeDef;
+typedef struct {
+    uint32_t OscillatorType, HSEState, HSEPredivValue, LSEState, HSIState, HSICalibrationValue, LSIState;
+    RCC_PLLInitTypeDef PLL;
+} RCC_OscInitTypeDef;
+typedef struct { uint32_t ClockType, SYSCLKSource, AHBCLKDivider, APB1CLKDivider, APB2CLKDivider; } RCC_ClkInitTypeDef;
+
+#define RCC_OSCILLATORTYPE_HSE  0x1u
+#define RCC_HSE_ON              0x1u
+#define RCC_HSE_PREDIV_DIV1     0x0u
+#define RCC_PLL_ON              0x2u
+#define RCC_PLLSOURCE_HSE       0x1u
+#define RCC_PLL_MUL9            0x7u
+#define RCC_CLOCKTYPE_SYSCLK    0x1u
+#define RCC_CLOCKTYPE_HCLK      0x2u
+#define RCC_CLOCKTYPE_PCLK1     0x4u
+#define RCC_CLOCKTYPE_PCLK2     0x8u
+#define RCC_SYSCLKSOURCE_PLLCLK 0x2u
+#define RCC_SYSCLK_DIV1         0x0u
+#define RCC_HCLK_DIV1           0x0u
+#define RCC_HCLK_DIV2           0x4u
+#define FLASH_LATENCY_2         0x2u
+
+#define __HAL_RCC_GPIOA_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_GPIOB_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_GPIOC_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_GPIOD_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_DMA1_CLK_ENABLE()  ((void)0)
+
+HAL_StatusTypeDef HAL_Init(void);
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *init);
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *init, uint32_t latency);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t ms);
+void HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t preempt, uint32_t sub);
+void HAL_NVIC_EnableIRQ(IRQn_Type irq);
+void HAL_NVIC_DisableIRQ(IRQn_Type irq);
+
+/* ===== TIM ===== */
+typedef struct {
+    __IO uint32_t CR1, CR2, SMCR, DIER, SR, EGR, CCMR1, CCMR2, CCER, CNT, PSC, ARR, RCR,
+                  CCR1, CCR2, CCR3, CCR4, BDTR, DCR, DMAR;
+} TIM_TypeDef;
+typedef struct { uint32_t Prescaler, CounterMode, Period, ClockDivision, RepetitionCounter, AutoReloadPreload; } TIM_Base_InitTypeDef;
+typedef struct { TIM_TypeDef *Instance; TIM_Base_InitTypeDef Init; } TIM_HandleTypeDef;
+typedef struct { uint32_t ClockSource, ClockPolarity, ClockPrescaler, ClockFilter; } TIM_ClockConfigTypeDef;
+typedef struct { uint32_t MasterOutputTrigger, MasterSlaveMode; } TIM_MasterConfigTypeDef;
+typedef struct { uint32_t OCMode, Pulse, OCPolarity, OCNPolarity, OCFastMode, OCIdleState, OCNIdleState; } TIM_OC_InitTypeDef;
+extern TIM_TypeDef sim_tim1, sim_tim2, sim_tim3, sim_tim4;
+#define TIM1 (&sim_tim1)
+#define TIM2 (&sim_tim2)
+#define TIM3 (&sim_tim3)
+#define TIM4 (&sim_tim4)
+
+#define TIM_CHANNEL_1                   0x00u
+#define TIM_CHANNEL_2                   0x04u
+#define TIM_CHANNEL_3                   0x08u
+#define TIM_CHANNEL_4                   0x0Cu
+#define TIM_COUNTERMODE_UP              0x0u
+#define TIM_CLOCKDIVISION_DIV1          0x0u
+#define TIM_AUTORELOAD_PRELOAD_DISABLE  0x0u
+#define TIM_CLOCKSOURCE_INTERNAL        0x1u
+#define TIM_TRGO_RESET                  0x0u
+#define TIM_MASTERSLAVEMODE_DISABLE     0x0u
+#define TIM_OCMODE_PWM1                 0x60u
+#define TIM_OCPOLARITY_HIGH             0x0u
+#define TIM_OCFAST_DISABLE              0x0u
+
+#define __HAL_TIM_SET_COMPARE(h, ch, v)  (*(&(h)->Instance->CCR1 + ((ch) >> 2)) = (v))
+#define __HAL_TIM_GET_COMPARE(h, ch)     (*(&(h)->Instance->CCR1 + ((ch) >> 2)))
+#define __HAL_TIM_SET_COUNTER(h, v)      ((h)->Instance->CNT = (v))
+#define __HAL_TIM_GET_COUNTER(h)         ((h)->Instance->CNT)
+#define __HAL_TIM_SET_AUTORELOAD(h, v)   ((h)->Instance->ARR = (v))
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *h);
+HAL_StatusTypeDef HAL_TIM_PWM_Init(TIM_HandleTypeDef *h);
+HAL_StatusTypeDef HAL_TIM_ConfigClockSource(TIM_HandleTypeDef *h, TIM_ClockConfigTypeDef *cfg);
+HAL_StatusTypeDef HAL_TIMEx_MasterConfigSynchronization(TIM_HandleTypeDef *h, TIM_MasterConfigTypeDef *cfg);
+HAL_StatusTypeDef HAL_TIM_PWM_ConfigChannel(TIM_HandleTypeDef *h, TIM_OC_InitTypeDef *cfg, uint32_t ch);
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *h, uint32_t ch);
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *h);
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *h);
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *h);
+
+/* ===== DMA ===== */
+typedef struct {
+    uint32_t Direction, PeriphInc, MemInc, PeriphDataAlignment, MemDataAlignment, Mode, Priority;
+} DMA_InitTypeDef;
+typedef struct { void *Instance; DMA_InitTypeDef Init; void *Parent; } DMA_HandleTypeDef;
+
+/* ===== I2C ===== */
+typedef struct {
+    uint32_t ClockSpeed, DutyCycle, OwnAddress1, AddressingMode, DualAddressMode,
+             OwnAddress2, GeneralCallMode, NoStretchMode;
+} I2C_InitTypeDef;
+typedef struct {
+    void *Instance;
+    I2C_InitTypeDef Init;
+    DMA_HandleTypeDef *hdmatx;
+    DMA_HandleTypeDef *hdmarx;
+    __IO uint32_t ErrorCode;
+} I2C_HandleTypeDef;
+extern uint32_t sim_i2c1;
+#define I2C1 ((void *)&sim_i2c1)
+
+#define I2C_DUTYCYCLE_2           0x0u
+#define I2C_ADDRESSINGMODE_7BIT   0x4000u
+#define I2C_DUALADDRESS_DISABLE   0x0u
+#define I2C_GENERALCALL_DISABLE   0x0u
+#define I2C_NOSTRETCH_DISABLE     0x0u
+#define I2C_MEMADD_SIZE_8BIT      0x1u
+#define I2C_MEMADD_SIZE_16BIT     0x10u
+#define HAL_I2C_ERROR_AF          0x4u
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *h);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_IT(I2C_HandleTypeDef *h, uint16_t addr, uint8_t *data, uint16_t len);
+HAL_StatusTypeDef HAL_I2C_Master_Receive_IT(I2C_HandleTypeDef *h, uint16_t addr, uint8_t *data, uint16_t len);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *h, uint16_t addr, uint16_t reg, uint16_t reg_size, uint8_t *data, uint16_t len);
+HAL_StatusTypeDef HAL_I2C_Mem_Write_IT(I2C_HandleTypeDef *h, uint16_t addr, uint16_t reg, uint16_t reg_size, uint8_t *data, uint16_t len);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_DMA(I2C_HandleTypeDef *h, uint16_t addr, uint8_t *data, uint16_t len);
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef *h, uint16_t addr, uint16_t reg, uint16_t reg_size, uint8_t *data, uint16_t len);
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *h);
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *h);
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *h);
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *h);
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *h);
+
+/* ===== UART ===== */
+typedef struct {
+    uint32_t BaudRate, WordLength, StopBits, Parity, Mode, HwFlowCtl, OverSampling;
+} UART_InitTypeDef;
+typedef struct {
+    void *Instance;
+    UART_InitTypeDef Init;
+} UART_HandleTypeDef;
+extern uint32_t sim_usart1;
+#define USART1 ((void *)&sim_usart1)
+
+#define UART_WORDLENGTH_8B        0x0u
+#define UART_STOPBITS_1           0x0u
+#define UART_PARITY_NONE          0x0u
+#define UART_MODE_TX              0x8u
+#define UART_MODE_RX              0x4u
+#define UART_MODE_TX_RX           0xCu
+#define UART_HWCONTROL_NONE       0x0u
+#define UART_OVERSAMPLING_16      0x0u
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *h);
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *h, const uint8_t *data, uint16_t len, uint32_t timeout);
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *h, uint8_t *data, uint16_t len);
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *h);
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *h);
+
+/* ===== FLASH: only the parameter pages exist, at their real address (hal.c maps them) ===== */
+#define FLASH_PAGE_SIZE           0x400u
+#define FLASH_TYPEERASE_PAGES     0x0u
+#define FLASH_TYPEPROGRAM_HALFWORD 0x1u
+#define FLASH_TYPEPROGRAM_WORD    0x2u
+typedef struct { uint32_t TypeErase, Banks, PageAddress, NbPages; } FLASH_EraseInitTypeDef;
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *init, uint32_t *page_error);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t type, uint32_t address, uint64_t data);
+
+#endif /* STM32F1XX_HAL_H */
@@ -0,0 +1,153 @@
+#include "sim.h"
+#include <string.h>
+
+/*
+ * The two formats the public maze collections use:
+ *
+ * Text: the maze drawn in ASCII, north at the top. Posts are 'o' or '+',
+ * horizontal walls "---", vertical walls '|'; anything inside a cell (S, G,
+ * spaces) is ignored.
+ *
+ *     o---o---o
+ *     |       |
+ *     o   o---o
+ *
+ * Binary (.maz): one byte per cell, column by column from the south-west
+ * corner (index x * H + y), wall bits N = 1, E = 2, S = 4, W = 8.
+ */
+
+#define MAZ_N   0x01
+#define MAZ_E   0x02
+#define MAZ_S   0x04
+#define MAZ_W   0x08
+
+#define LINE_MAX_CHARS  (4 * W + 16)
+
+static void clear_known(MazeWalls *m) {
+    Maze_Clear(m);
+    for (int y = 0; y < H; y++) m->knownNorth[y] = m->knownEast[y] = (uint16_t)((1u << W) - 1);
+}
+
+static bool is_post(char c) { return c == 'o' || c == '+'; }
+
+// Character at column i of a line, spaces past its end
+static char at(const char *line, int i) {
+    return (i < (int)strlen(line)) ? line[i] : ' ';
+}
+
+static bool read_text(FILE *in, const char *path, MazeWalls *m) {
+    static char lines[2 * H + 1][LINE_MAX_CHARS];
+    char buf[LINE_MAX_CHARS];
+    int n = 0;
+
+    // Keep the post rows and the cell rows between them, skip anything around the drawing
+    while (fgets(buf, sizeof(buf), in)) {
+        buf[strcspn(buf, "\r\n")] = '\0';
+        size_t lead = strspn(buf, " \t");
+        if (n == 0 && !is_post(buf[lead])) continue;
+        if (n == 2 * H + 1) break;
+        if (lead != 0 || ((n % 2 == 0) != is_post(buf[0]))) {
+            fprintf(stderr, "%s: line %d of the drawing is malformed\n", path, n + 1);
+            return false;
+        }
+        strcpy(lines[n++], buf);
+    }
+
+    int width = ((int)strlen(lines[0]) - 1) / 4;
+    if (n != 2 * H + 1 || width != W) {
+        fprintf(stderr, "%s: expected a %dx%d maze\n", path, W, H);
+        return false;
+    }
+
+    clear_known(m);
+    for (int y = 0; y < H; y++) {
+        const char *north = lines[2 * (H - 1 - y)];
+        const char *cells = lines[2 * (H - 1 - y) + 1];
+        for (int x = 0; x < W; x++) {
+            if (at(north, 4 * x + 2) == '-') Maze_SetWall(m, x, y, North, true);
+            if (at(cells, 4 * (x + 1)) == '|') Maze_SetWall(m, x, y, East, true);
+        }
+    }
+    return true;
+}
+
+static bool read_binary(const uint8_t *cells, MazeWalls *m) {
+    clear_known(m);
+    for (int x = 0; x < W; x++) {
+        for (int y = 0; y < H; y++) {
+            uint8_t c = cells[x * H + y];
+            // A wall seen from either side counts
+            if (c & MAZ_N) Maze_SetWall(m, x, y, North, true);
+            if (c & MAZ_E) Maze_SetWall(m, x, y, East, true);
+            if (c & MAZ_S) Maze_SetWall(m, x, y, South, true);
+            if (c & MAZ_W) Maze_SetWall(m, x, y, West, true);
+        }
+    }
+    return true;
+}
+
+bool mazefile_read(const char *path, MazeWalls *m) {
+    FILE *in = fopen(path, "rb");
+    if (!in) {
+        perror(path);
+        return false;
+    }
+
+    // Exactly one small byte per cell is a binary maze; anything else should be a drawing
+    uint8_t cells[W * H + 1];
+    size_t size = fread(cells, 1, sizeof(cells), in);
+    bool binary = (size == W * H);
+    for (size_t i = 0; binary && i < size; i++) binary = cells[i] < 16;
+
+    bool ok;
+    if (binary) {
+        ok = read_binary(cells, m);
+    } else {
+        rewind(in);
+        ok = read_text(in, path, m);
+    }
+    fclose(in);
+    return ok;
+}
+
+void mazefile_print(FILE *out, const MazeWalls *m, int mark_x, int mark_y) {
+    for (int y = H - 1; y >= 0; y--) {
+        for (int x = 0; x < W; x++) fputs(Maze_HasWall(m, x, y, North) ? "o---" : "o   ", out);
+        fputs("o\n|", out);
+        for (int x = 0; x < W; x++) {
+            fputs((x == mark_x && y == mark_y) ? " M " : "   ", out);
+            fputc(Maze_HasWall(m, x, y, East) ? '|' : ' ', out);
+        }
+        fputc('\n', out);
+    }
+    for (int x = 0; x < W; x++) fputs("o---", out);
+    fputs("o\n", out);
+}
+
+// .maz by extension, the text drawing otherwise
+bool mazefile_write(const char *path, const MazeWalls *m) {
+    const char *ext = strrchr(path, '.');
+    bool binary = ext && strcmp(ext, ".maz") == 0;
+
+    FILE *out = fopen(path, binary ? "wb" : "w");
+    if (!out) {
+        perror(path);
+        return false;
+    }
+
+    if (binary) {
+        uint8_t cells[W * H];
+        for (int x = 0; x < W; x++) {
+            for (int y = 0; y < H; y++) {
+                cells[x * H + y] = (uint8_t)((Maze_HasWall(m, x, y, North) ? MAZ_N : 0) |
+                                             (Maze_HasWall(m, x, y, East)  ? MAZ_E : 0) |
+                                             (Maze_HasWall(m, x, y, South) ? MAZ_S : 0) |
+                                             (Maze_HasWall(m, x, y, West)  ? MAZ_W : 0));
+            }
+        }
+        fwrite(cells, 1, sizeof(cells), out);
+    } else {
+        mazefile_print(out, m, -1, -1);
+    }
+    return fclose(out) == 0;
+}
@@ -0,0 +1,112 @@
+#include "sim.h"
+#include <math.h>
+#include <stdlib.h>
+
+/*
+ * Differential drive on two DC motors. Above a static-friction dead band the
+ * PWM drives each wheel towards (pwm - KS) / KV mm/s with a first-order lag.
+ * The constants sit near the firmware's feedforward, not on it, and the two
+ * sides differ a little, as real motors and wheels do.
+ */
+#define MOTOR_KS        75.0    // PWM lost to static friction
+#define MOTOR_KV        0.31    // PWM per mm/s at steady state
+#define MOTOR_TAU_S     0.065   // Speed lag, about KA / KV
+#define BRAKE_TAU_S     0.015   // Both inputs high: the shorted motor stops fast
+#define RIGHT_GAIN      0.96    // Right motor a little weaker
+#define LEFT_MM_SCALE   1.004   // True travel per nominal mm: wheel diameter tolerance
+#define RIGHT_MM_SCALE  0.997
+
+/*
+ * ToF mounts relative to the axle centre: forward, left, pointing angle.
+ * The modules carry an uncalibrated part-to-part offset; with it, a centred
+ * robot reads what the firmware is tuned for (CENTER_MM_DEFAULT at the sides,
+ * the 90 mm front stop at the cell centre).
+ */
+#define TOF_OFFSET_MM   26.0
+#define TOF_NOISE_MM    1.0
+
+static const struct { double fwd, left, angle; } TOF_MOUNT[SIM_TOF_COUNT] = {
+    { 20.0,  10.0,  M_PI / 2 },     // Left
+    { 20.0,   0.0,  0.0 },          // Front
+    { 20.0, -10.0, -M_PI / 2 },     // Right
+};
+
+SimRobot sim_robot;
+
+static double travel_left, travel_right;    // True ground travel of each wheel, mm
+static double yaw_rate;                     // rad/s
+static uint32_t rng;
+
+void robot_reset(int cell_x, int cell_y, Direction facing, uint32_t seed) {
+    static const double HEADING[4] = { M_PI / 2, 0.0, -M_PI / 2, M_PI };
+    rng = seed * 747796405u + 1;
+
+    // Placed by hand: a couple of mm and a degree or so off
+    sim_robot = (SimRobot){
+        .x = (cell_x + 0.5) * CELL_MM + 2.0 * sim_gauss(&rng),
+        .y = (cell_y + 0.5) * CELL_MM + 2.0 * sim_gauss(&rng),
+        .heading = HEADING[facing] + 0.02 * sim_gauss(&rng),
+    };
+    yaw_rate = 0;   // The wheels keep their counts: lifted, they hardly turn
+}
+
+static double motor_step(double v, int pwm, double gain, double dt) {
+    if (pwm > 255) return v - v * dt / BRAKE_TAU_S;
+
+    double target = 0;
+    if (abs(pwm) > MOTOR_KS) target = copysign(abs(pwm) - MOTOR_KS, pwm) / MOTOR_KV * gain;
+    return v + (target - v) * dt / MOTOR_TAU_S;
+}
+
+void robot_step(double dt) {
+    SimRobot *r = &sim_robot;
+    if (r->crashed || r->held) {
+        r->v_left = r->v_right = 0;
+        yaw_rate = 0;
+        return;
+    }
+
+    r->v_left = motor_step(r->v_left, sim_motor_pwm(0), 1.0, dt);
+    r->v_right = motor_step(r->v_right, sim_motor_pwm(1), RIGHT_GAIN, dt);
+
+    double v = (r->v_left + r->v_right) / 2;
+    yaw_rate = (r->v_right - r->v_left) / SIM_TRACK_MM;
+
+    double heading = r->heading + yaw_rate * dt / 2;
+    double x = r->x + v * cos(heading) * dt;
+    double y = r->y + v * sin(heading) * dt;
+    if (world_collides(x, y, SIM_BODY_R_MM)) {
+        r->crashed = true;
+        r->v_left = r->v_right = 0;
+        yaw_rate = 0;
+        return;
+    }
+    r->x = x;
+    r->y = y;
+    r->heading = remainder(r->heading + yaw_rate * dt, 2 * M_PI);
+
+    travel_left += r->v_left * dt;
+    travel_right += r->v_right * dt;
+    sim_encoder_set(0, (int32_t)floor(travel_left / (MM_PER_TICK * LEFT_MM_SCALE)));
+    sim_encoder_set(1, (int32_t)floor(travel_right / (MM_PER_TICK * RIGHT_MM_SCALE)));
+}
+
+double robot_tof_mm(int sensor) {
+    const SimRobot *r = &sim_robot;
+    double c = cos(r->heading), s = sin(r->heading);
+    double x = r->x + TOF_MOUNT[sensor].fwd * c - TOF_MOUNT[sensor].left * s;
+    double y = r->y + TOF_MOUNT[sensor].fwd * s + TOF_MOUNT[sensor].left * c;
+
+    double d = world_raycast(x, y, r->heading + TOF_MOUNT[sensor].angle, SIM_TOF_MAX_MM);
+    if (d >= SIM_TOF_MAX_MM) return INFINITY;
+    return d + TOF_OFFSET_MM + TOF_NOISE_MM * sim_gauss(&rng);
+}
+
+double robot_yaw_rate_dps(void) {
+    return yaw_rate * (180.0 / M_PI);
+}
+
+void robot_cell(int *cx, int *cy) {
+    *cx = (int)floor(sim_robot.x / CELL_MM);
+    *cy = (int)floor(sim_robot.y / CELL_MM);
+}
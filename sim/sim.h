@@ -0,0 +1,85 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include "stm32f1xx_hal.h"
+#include "config.h"
+#include "maze.h"
+#include <stdio.h>
+
+/*
+ * Host simulator. The firmware runs unmodified on one host thread; simulated
+ * time only moves when it touches hardware (a tick read, a pin read, an
+ * interrupt lock, a WFI). Each touch costs SIM_ACCESS_US; timer, bus and
+ * encoder interrupts that fall due are dispatched right there, so everything
+ * runs in lock-step with the robot model and as fast as the host allows.
+ */
+
+#define SIM_CPU_HZ       72000000u
+#define SIM_ACCESS_US    4          // Simulated cost of one hardware access from thread code
+#define SIM_PHYS_US      100        // Robot model integration step
+
+/* Robot geometry, mm */
+#define SIM_TRACK_MM     66.0       // Wheel spacing; TICKS_PER_TURN assumes ~65
+#define SIM_BODY_R_MM    38.0       // Collision radius
+#define SIM_WALL_MM      12.0       // Wall and post thickness
+#define SIM_TOF_MAX_MM   200.0      // Longest reading before the sensor reports no target
+
+enum { SIM_TOF_LEFT, SIM_TOF_FRONT, SIM_TOF_RIGHT, SIM_TOF_COUNT };
+
+/* ===== Scheduler (hal.c) ===== */
+uint64_t sim_now_us(void);
+void sim_access(void);              // Thread-context hardware access: time moves on by SIM_ACCESS_US
+void sim_wait_event(void);          // WFI: jump to the next interrupt
+void sim_set_pin(GPIO_TypeDef *port, uint16_t pin, bool level);    // Input level
+bool sim_get_pin(GPIO_TypeDef *port, uint16_t pin);   // Output level the firmware drives
+uint32_t sim_pin_reads(GPIO_TypeDef *port, uint16_t pin); // How often the firmware polled the pin
+int  sim_motor_pwm(int side);       // Signed duty the DRV8833 sees, 0 = left; 256 means braking
+void sim_encoder_set(int side, int32_t count);
+void sim_thread_point(void);        // sim_main.c: script and end checks, between firmware statements
+extern FILE *sim_uart_out;          // Where USART1 TX goes; NULL drops it
+extern uint32_t sim_uart_sent;      // Bytes sent on USART1 so far, wherever they went
+void sim_uart_type(const void *data, size_t len);  // USART1 RX input, kept by the caller until sent
+bool sim_uart_typing(void);         // Not all of it received yet
+uint8_t *sim_flash(void);           // The parameter pages, erased until loaded; maps them on first use
+
+/* ===== I2C devices (devices.c) ===== */
+void devices_reset(uint32_t seed);
+void devices_step(uint64_t now_us);
+// Transfer as seen on the wire; false when nobody acknowledges the address
+bool devices_write(uint8_t addr7, const uint8_t *data, uint16_t len);
+bool devices_read(uint8_t addr7, uint8_t *data, uint16_t len);
+extern int sim_tof_override_mm[SIM_TOF_COUNT];  // >= 0 replaces the reading (a hand over the sensor)
+
+/* ===== Robot model (robot.c) ===== */
+typedef struct {
+    double x, y, heading;           // mm from the maze's south-west corner; rad, 0 = east
+    double v_left, v_right;         // mm/s
+    bool crashed;
+    bool held;                      // Pinned where it stands, wheels and all: a stall the sensors can't see
+} SimRobot;
+
+extern SimRobot sim_robot;
+void robot_reset(int cell_x, int cell_y, Direction facing, uint32_t seed);
+void robot_step(double dt);
+double robot_tof_mm(int sensor);    // Distance the sensor reports, before rounding
+double robot_yaw_rate_dps(void);
+void robot_cell(int *cx, int *cy);
+
+/* ===== World (world.c) ===== */
+extern MazeWalls sim_maze;
+void world_generate(uint32_t seed, int extra_openings);
+void world_build(void);             // Rebuild the collision geometry after sim_maze changes
+double world_raycast(double x, double y, double angle, double max_mm);
+bool world_collides(double x, double y, double radius);
+void world_load(const MazeWalls *m);
+
+/* ===== Maze files (mazefile.c): the text drawing or the 256-byte .maz ===== */
+bool mazefile_read(const char *path, MazeWalls *m);
+bool mazefile_write(const char *path, const MazeWalls *m);
+void mazefile_print(FILE *out, const MazeWalls *m, int mark_x, int mark_y);
+
+/* ===== Shared helpers ===== */
+uint32_t sim_rand(uint32_t *state);
+double sim_gauss(uint32_t *state);
+
+#endif // SIM_H
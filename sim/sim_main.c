@@ -0,0 +1,513 @@
+#include "sim.h"
+#include "menu.h"
+#include "floodfill.h"
+#include "motion.h"
+#include "perf.h"
+#include "telemetry.h"
+#include "params.h"
+#include "MPU.h"
+#include <getopt.h>
+#include <libgen.h>
+#include <math.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+int firmware_main(void);    // The firmware's main(), renamed at compile time
+
+#define PRESS_MS        100     // Confirm button held this long
+#define HAND_DELAY_MS   300     // Hand over the side sensors this long after the menu pick
+#define HAND_MS         250
+#define HAND_MM         20
+#define IDLE_DONE_MS    1000    // Standing still this long during a run ends it
+#define CONSOLE_MS      100     // Pause after each console line, for the firmware to act on it
+#define MENU_START      (MAIN_MENU_COUNT - 2)   // The main menu ends with Start and Speed Run
+#define MENU_SPEED_RUN  (MAIN_MENU_COUNT - 1)
+
+static struct {
+    uint32_t seed;
+    int openings;
+    double timeout_s;
+    int speed, turn, search;
+    int goal_x, goal_y;
+    int stall;          // Hold the speed run still once it has entered this many cells; 0 never
+    bool show, trace, bench, profile, speedrun;
+    const char *maze, *save, *telemetry, *params, *console;
+} opt = { 1, 12, 600.0, 0, 0, 0, W / 2 - 1, H / 2 - 1, 0, false, false, false, false, false, NULL, NULL, NULL, NULL, NULL };
+
+/* Operator script: type the console lines, pick Start in the menu, then wave a hand over the sides.
+   With --speedrun, once the search is home: put the robot back on the start, pick Speed Run, wave again */
+typedef enum { SCRIPT_BOOT, SCRIPT_CONSOLE, SCRIPT_PRESS, SCRIPT_WAIT_HAND, SCRIPT_HAND, SCRIPT_RUN, SCRIPT_DONE } ScriptState;
+
+static ScriptState state;
+static uint64_t state_us;
+static uint64_t run_start_us;
+static const char *outcome = "firmware returned";
+static bool success;
+static jmp_buf finished;
+static uint16_t visited[H];
+static int cell_x = -1, cell_y = -1;
+static uint64_t idle_since_us;
+static char *console_text;
+static size_t console_len, console_pos;
+
+// Types the next line of the console script; false when all are sent
+static bool type_line(void) {
+    if (console_pos >= console_len) return false;
+    char *end = memchr(console_text + console_pos, '\n', console_len - console_pos);
+    size_t len = end ? (size_t)(end - console_text) + 1 - console_pos : console_len - console_pos;
+    sim_uart_type(console_text + console_pos, len);
+    console_pos += len;
+    return true;
+}
+
+// The search as the firmware planned it
+static struct {
+    int x, y;
+    Direction dir;
+    int moves, turns;
+    int moves_to_goal;  // -1 until the firmware first stands in the goal
+} search = { 0, 0, North, 0, 0, -1 };
+
+// The speed run the firmware drives after the search
+static struct {
+    bool on;
+    double search_s;    // How long the search before it took
+    uint16_t route[H];  // Cells of the firmware's fastest path
+    int cells;
+    double seconds;     // From the hand to standing still; < 0 until it ends in the goal
+    double worst_mm;    // Farthest cell-edge crossing from the edge's midpoint
+    uint64_t held_us;   // With --stall: when the robot was pinned, 0 before
+    uint32_t held_sent; // Serial bytes sent by then
+} speed = { .seconds = -1.0 };
+
+// A speed run along the firmware's fastest path over some wall map
+typedef struct {
+    int cells, turns;
+    double seconds;     // < 0: no route
+} RunEstimate;
+
+// The firmware's goal: the chosen cell or the centre 2x2
+static bool in_goal(int cx, int cy) {
+    if (cx == opt.goal_x && cy == opt.goal_y) return true;
+    return cx >= W / 2 - 1 && cx <= W / 2 && cy >= H / 2 - 1 && cy <= H / 2;
+}
+
+static void track_search(void) {
+    int x = FloodFill_GetX(), y = FloodFill_GetY();
+    Direction dir = FloodFill_GetDir();
+    if (dir != search.dir) search.turns++;
+    if (x != search.x || y != search.y) {
+        search.moves++;
+        if (search.moves_to_goal < 0 && in_goal(x, y)) search.moves_to_goal = search.moves;
+    }
+    search.x = x;
+    search.y = y;
+    search.dir = dir;
+}
+
+// The route the firmware is about to plan, from the same walls, pose and goal
+static void plan_speed_run(void) {
+    static Direction path[W * H];
+    int length = 0, x = 0, y = 0;
+    FloodFill_ResetPose();
+    FloodFill_GetFastestPath(path, &length);
+    speed.route[0] = 1u;
+    for (int i = 0; i < length; i++) {
+        x += (path[i] == East) - (path[i] == West);
+        y += (path[i] == North) - (path[i] == South);
+        speed.route[y] |= (uint16_t)(1u << x);
+    }
+}
+
+// The robot crossed into (cx,cy) from column px: how far off the shared edge's midpoint
+static double edge_offset_mm(int px, int cx, int cy) {
+    if (px != cx) return fabs(sim_robot.y - (cy + 0.5) * CELL_MM);
+    return fabs(sim_robot.x - (cx + 0.5) * CELL_MM);
+}
+
+static void enter(ScriptState s) {
+    state = s;
+    state_us = sim_now_us();
+}
+
+static void finish(const char *what, bool ok) {
+    outcome = what;
+    success = ok;
+    state = SCRIPT_DONE;    // Firmware calls made for the report must not end the run again
+    longjmp(finished, 1);
+}
+
+void sim_thread_point(void) {
+    uint64_t now = sim_now_us();
+    uint64_t since = now - state_us;
+
+    switch (state) {
+        case SCRIPT_BOOT:
+            // The main loop polls the button: boot and calibration are over
+            if (sim_pin_reads(BTN_CONFIRM_PORT, BTN_CONFIRM_PIN) > 0) {
+                if (type_line()) {
+                    sim_uart_out = stdout;  // The console's replies
+                    enter(SCRIPT_CONSOLE);
+                    break;
+                }
+                sim_set_pin(BTN_CONFIRM_PORT, BTN_CONFIRM_PIN, false);
+                enter(SCRIPT_PRESS);
+            }
+            break;
+        case SCRIPT_CONSOLE:
+            // A line at a time, as typed: the firmware reads the console between its other work
+            if (sim_uart_typing()) state_us = now;
+            else if (since < CONSOLE_MS * 1000u) break;
+            else if (type_line()) enter(SCRIPT_CONSOLE);
+            else {
+                fflush(stdout);
+                sim_uart_out = NULL;
+                sim_set_pin(BTN_CONFIRM_PORT, BTN_CONFIRM_PIN, false);
+                enter(SCRIPT_PRESS);
+            }
+            break;
+        case SCRIPT_PRESS:
+            if (since >= PRESS_MS * 1000u) {
+                sim_set_pin(BTN_CONFIRM_PORT, BTN_CONFIRM_PIN, true);
+                enter(SCRIPT_WAIT_HAND);
+            }
+            break;
+        case SCRIPT_WAIT_HAND:
+            if (since >= HAND_DELAY_MS * 1000u) {
+                sim_tof_override_mm[SIM_TOF_LEFT] = sim_tof_override_mm[SIM_TOF_RIGHT] = HAND_MM;
+                enter(SCRIPT_HAND);
+            }
+            break;
+        case SCRIPT_HAND:
+            if (since >= HAND_MS * 1000u) {
+                sim_tof_override_mm[SIM_TOF_LEFT] = sim_tof_override_mm[SIM_TOF_RIGHT] = -1;
+                enter(SCRIPT_RUN);
+                run_start_us = idle_since_us = now;
+            }
+            break;
+        case SCRIPT_RUN: {
+            int cx, cy;
+            robot_cell(&cx, &cy);
+            if (cx != cell_x || cy != cell_y) {
+                if (speed.on) {
+                    double off = edge_offset_mm(cell_x, cx, cy);
+                    if (off > speed.worst_mm) speed.worst_mm = off;
+                    speed.cells++;
+                    if (cx < 0 || cx >= W || cy < 0 || cy >= H || !(speed.route[cy] >> cx & 1u))
+                        finish("speed run left the route", false);
+                }
+                cell_x = cx;
+                cell_y = cy;
+                if (cx >= 0 && cx < W && cy >= 0 && cy < H) visited[cy] |= (uint16_t)(1u << cx);
+                if (opt.trace)
+                    printf("%9.3f s  cell (%d,%d), firmware thinks (%d,%d)\n", (now - run_start_us) * 1e-6,
+                           cx, cy, FloodFill_GetX(), FloodFill_GetY());
+            }
+            if (!speed.on) track_search();
+            if (speed.on && opt.stall > 0 && !sim_robot.held && speed.cells >= opt.stall) {
+                sim_robot.held = true;
+                speed.held_us = now;
+                speed.held_sent = sim_uart_sent;
+            }
+            if (sim_robot.crashed) finish(speed.on ? "speed run crashed" : "crashed into a wall", false);
+            if (since >= (uint64_t)(opt.timeout_s * 1e6)) finish("timed out", false);
+
+            // Between moves the planner queues the next one at once; a long
+            // stop means the firmware has ended the search
+            if (!Motion_Idle()) idle_since_us = now;
+            else if (now - idle_since_us >= IDLE_DONE_MS * 1000u) {
+                if (sim_robot.held) {
+                    // Held, the firmware must give up on the route after one stall
+                    // timeout, not stall again on the moves still to queue, and report
+                    speed.seconds = (idle_since_us - speed.held_us) * 1e-6;
+                    if (sim_uart_sent == speed.held_sent) finish("stalled without a telemetry dump", false);
+                    if (speed.seconds > 1.5 * MOTION_STALL_MS * 1e-3) finish("kept driving after the stall", false);
+                    finish("stopped at the stall", true);
+                }
+                if (cx != FloodFill_GetX() || cy != FloodFill_GetY()) finish("stopped but lost its position", false);
+                if (speed.on) {
+                    if (!in_goal(cx, cy)) finish("speed run stopped short", false);
+                    speed.seconds = (idle_since_us - run_start_us) * 1e-6;
+                    finish("ran to the goal", true);
+                }
+                if (search.moves_to_goal < 0) finish("stopped before the goal", false);
+                if (cx != 0 || cy != 0) finish("stopped away from the start", false);
+                if (!opt.speedrun) finish("explored and returned", true);
+
+                speed.on = true;
+                speed.search_s = (now - run_start_us) * 1e-6;
+                plan_speed_run();
+                robot_reset(0, 0, North, opt.seed + 1);
+                cell_x = cell_y = 0;
+                mainIndex = MENU_SPEED_RUN;
+                sim_set_pin(BTN_CONFIRM_PORT, BTN_CONFIRM_PIN, false);
+                enter(SCRIPT_PRESS);
+            }
+            break;
+        }
+        case SCRIPT_DONE:
+            break;
+    }
+}
+
+/*
+ * Rough speed-run time: every straight starts and ends at rest on a trapezoid
+ * at the accel parameter up to the chosen cruise speed, every turn is a pivot
+ * with the wheels at pivot_v. Good for comparing routes, not for lap times.
+ */
+static double straight_s(double mm, double v, double a) {
+    if (mm >= v * v / a) return mm / v + v / a;
+    return 2.0 * sqrt(mm / a);
+}
+
+static RunEstimate estimate_run(const MazeWalls *m) {
+    static Direction path[W * H];
+    int length = 0;
+
+    FloodFill_SetGoal(opt.goal_x, opt.goal_y);
+    FloodFill_LoadMaze(m);
+    FloodFill_GetFastestPath(path, &length);
+
+    RunEstimate est = { length, 0, -1.0 };
+    if (length == 0) return est;
+
+    double v = Params_Get(opt.speed ? PARAM_SPEED_FAST : PARAM_SPEED_MEDIUM) / 1000.0;
+    double accel = Params_Get(PARAM_ACCEL) / 1000.0;
+    double quarter_s = (M_PI / 2) * (SIM_TRACK_MM / 2) / (Params_Get(PARAM_PIVOT_SPEED) / 1000.0);
+    Direction dir = North;
+    int run = 0;
+    est.seconds = 0;
+    for (int i = 0; i <= length; i++) {
+        if (i < length && path[i] == dir) {
+            run++;
+            continue;
+        }
+        if (run) est.seconds += straight_s(run * (double)CELL_MM, v, accel);
+        if (i == length) break;
+        int quarters = (path[i] - dir + 4) % 4;
+        est.turns++;
+        est.seconds += ((quarters == 2) ? 2 : 1) * quarter_s;
+        dir = path[i];
+        run = 1;
+    }
+    return est;
+}
+
+// The parameter pages persist between runs in a file, like the robot's flash between resets
+static bool flash_image(const char *path, bool write) {
+    enum { LEN = PARAMS_FLASH_PAGES * FLASH_PAGE_SIZE };
+    uint8_t image[LEN + 1];
+    FILE *f = fopen(path, write ? "wb" : "rb");
+    if (!f) {
+        if (!write) return true;    // No image yet: the pages start erased
+        perror(path);
+        return false;
+    }
+
+    bool ok;
+    if (write) {
+        ok = fwrite(sim_flash(), 1, LEN, f) == LEN;
+    } else {
+        ok = fread(image, 1, sizeof(image), f) == LEN;
+        if (ok) memcpy(sim_flash(), image, LEN);
+        else fprintf(stderr, "%s: not a %d-byte parameter flash image\n", path, LEN);
+    }
+    return (fclose(f) == 0) && ok;
+}
+
+// The console script, whole; sim_uart_type() sends it from this buffer
+static bool read_console(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    size_t cap = 4096;
+    console_text = malloc(cap);
+    size_t n;
+    while (console_text && (n = fread(console_text + console_len, 1, cap - console_len, f)) > 0) {
+        console_len += n;
+        if (console_len == cap) console_text = realloc(console_text, cap *= 2);
+    }
+    fclose(f);
+    return console_text != NULL;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -s, --seed N       maze and noise seed (default 1)\n"
+            "  -o, --openings N   extra walls removed from the perfect maze (default 12)\n"
+            "  -m, --maze FILE    run in this maze (text drawing or .maz) instead of a random one\n"
+            "      --save FILE    write the maze out (.maz for binary) and run in it\n"
+            "  -t, --timeout S    give up after S simulated seconds of running (default 600)\n"
+            "      --speed N      menu speed index: 0 medium, 1 fast\n"
+            "      --turn N       menu turn index: 0 pivot, 1 curve, 2 diagonal\n"
+            "      --search N     menu search index: 0 stop, 1 flow\n"
+            "      --speedrun     after the search, put the robot back on the start and run Speed Run\n"
+            "      --stall N      hold the speed run still once it has entered N cells\n"
+            "      --goal X,Y     goal cell (default %d,%d)\n"
+            "      --show         print the maze and where the robot ended\n"
+            "      --trace        print every cell the robot enters\n"
+            "      --bench        print one tab-separated result line (see bench.sh)\n"
+            "      --profile      print the firmware's timing zones in simulated time (bus waits; code runs free)\n"
+            "      --telemetry F  write the telemetry dump of the run's last ticks to F (see tlm2csv)\n"
+            "      --params F     flash image of the parameter pages: loaded if F exists, written back after\n"
+            "      --console F    type the lines of F at the serial console before the run (list, set, save...)\n",
+            prog, W / 2 - 1, H / 2 - 1);
+}
+
+static void parse(int argc, char **argv) {
+    enum { OPT_SPEED = 256, OPT_TURN, OPT_SEARCH, OPT_GOAL, OPT_SHOW, OPT_TRACE, OPT_SAVE, OPT_BENCH, OPT_PROFILE, OPT_TELEMETRY,
+           OPT_PARAMS, OPT_CONSOLE, OPT_SPEEDRUN, OPT_STALL };
+    static const struct option longopts[] = {
+        { "seed",     required_argument, NULL, 's' },
+        { "openings", required_argument, NULL, 'o' },
+        { "maze",     required_argument, NULL, 'm' },
+        { "save",     required_argument, NULL, OPT_SAVE },
+        { "timeout",  required_argument, NULL, 't' },
+        { "speed",    required_argument, NULL, OPT_SPEED },
+        { "turn",     required_argument, NULL, OPT_TURN },
+        { "search",   required_argument, NULL, OPT_SEARCH },
+        { "speedrun", no_argument,       NULL, OPT_SPEEDRUN },
+        { "stall",    required_argument, NULL, OPT_STALL },
+        { "goal",     required_argument, NULL, OPT_GOAL },
+        { "show",     no_argument,       NULL, OPT_SHOW },
+        { "trace",    no_argument,       NULL, OPT_TRACE },
+        { "bench",    no_argument,       NULL, OPT_BENCH },
+        { "profile",  no_argument,       NULL, OPT_PROFILE },
+        { "telemetry", required_argument, NULL, OPT_TELEMETRY },
+        { "params",   required_argument, NULL, OPT_PARAMS },
+        { "console",  required_argument, NULL, OPT_CONSOLE },
+        { "help",     no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "s:o:m:t:h", longopts, NULL)) != -1) {
+        switch (c) {
+            case 's': opt.seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'o': opt.openings = atoi(optarg); break;
+            case 'm': opt.maze = optarg; break;
+            case OPT_SAVE: opt.save = optarg; break;
+            case 't': opt.timeout_s = atof(optarg); break;
+            case OPT_SPEED: opt.speed = atoi(optarg); break;
+            case OPT_TURN: opt.turn = atoi(optarg); break;
+            case OPT_SEARCH: opt.search = atoi(optarg); break;
+            case OPT_SPEEDRUN: opt.speedrun = true; break;
+            case OPT_STALL: opt.stall = atoi(optarg); break;
+            case OPT_GOAL:
+                if (sscanf(optarg, "%d,%d", &opt.goal_x, &opt.goal_y) != 2) {
+                    usage(argv[0]);
+                    exit(2);
+                }
+                break;
+            case OPT_SHOW: opt.show = true; break;
+            case OPT_TRACE: opt.trace = true; break;
+            case OPT_BENCH: opt.bench = true; break;
+            case OPT_PROFILE: opt.profile = true; break;
+            case OPT_TELEMETRY: opt.telemetry = optarg; break;
+            case OPT_PARAMS: opt.params = optarg; break;
+            case OPT_CONSOLE: opt.console = optarg; break;
+            default:
+                usage(argv[0]);
+                exit(c == 'h' ? 0 : 2);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    parse(argc, argv);
+
+    if (opt.maze) {
+        MazeWalls m;
+        if (!mazefile_read(opt.maze, &m)) return 2;
+        world_load(&m);
+    } else {
+        world_generate(opt.seed, opt.openings);
+    }
+    if (opt.save && !mazefile_write(opt.save, &sim_maze)) return 2;
+    robot_reset(0, 0, North, opt.seed);
+    devices_reset(opt.seed);
+
+    // Menu choices as if dialled in with the wheels; the cursor rests on Start
+    selectedSpeedIndex = opt.speed;
+    selectedTurnIndex = opt.turn;
+    selectedSearchIndex = opt.search;
+    goalX = opt.goal_x;
+    goalY = opt.goal_y;
+    mainIndex = MENU_START;
+
+    sim_flash();
+    if (opt.params && !flash_image(opt.params, false)) return 2;
+    if (opt.console && !read_console(opt.console)) return 2;
+
+    clock_t host_start = clock();
+    if (!setjmp(finished)) firmware_main();
+    double host_s = (double)(clock() - host_start) / CLOCKS_PER_SEC;
+
+    int cx, cy, cells = 0;
+    robot_cell(&cx, &cy);
+    for (int y = 0; y < H; y++) cells += __builtin_popcount(visited[y]);
+    double run_s = (run_start_us != 0) ? (sim_now_us() - run_start_us) * 1e-6 : 0.0;
+    double search_s = speed.on ? speed.search_s : run_s;
+    double sim_s = sim_now_us() * 1e-6;
+
+    // The serial dump the firmware sends after a run, also after a crash or a timeout
+    if (opt.telemetry) {
+        sim_uart_out = fopen(opt.telemetry, "wb");
+        if (!sim_uart_out) {
+            perror(opt.telemetry);
+            return 2;
+        }
+        Telemetry_Stop();
+        Telemetry_Dump();
+        fclose(sim_uart_out);
+        sim_uart_out = NULL;
+    }
+    if (opt.params && !flash_image(opt.params, true)) return 2;
+
+    // The firmware is finished with its wall map: plan speed runs over what it
+    // learned and, for comparison, over the whole maze
+    MazeWalls learned = *FloodFill_GetWalls();
+    RunEstimate run = estimate_run(&learned);
+    RunEstimate best = estimate_run(&sim_maze);
+
+    char label[64];
+    if (opt.maze) snprintf(label, sizeof(label), "%s", basename((char *)opt.maze));
+    else snprintf(label, sizeof(label), "seed %u", opt.seed);
+
+    if (opt.bench) {
+        printf("%s\t%s\t%.2f\t%d\t%d\t%d\t%d\t%d\t%d\t%.2f\t%d\t%d\t%.2f\t%.2f\t%.0f\n",
+               label, success ? "ok" : outcome, search_s, cells, search.moves, search.moves_to_goal, search.turns,
+               run.cells, run.turns, run.seconds, best.cells, best.turns, best.seconds, speed.seconds, speed.worst_mm);
+        return success ? 0 : 1;
+    }
+
+    if (opt.show) mazefile_print(stdout, &sim_maze, cx, cy);
+    printf("%s: %s after %.2f s at (%d,%d), %d cells visited "
+           "(%.1f s simulated in %.2f s, %.0fx real time)\n",
+           label, outcome, run_s, cx, cy, cells, sim_s, host_s, host_s > 0 ? sim_s / host_s : 0.0);
+    printf("  search: %.2f s, %d moves, goal after %d, %d turns\n", search_s, search.moves, search.moves_to_goal, search.turns);
+    printf("  speed run on the learned walls: %d cells, %d turns, about %.2f s "
+           "(whole maze known: %d cells, %d turns, %.2f s)\n",
+           run.cells, run.turns, run.seconds, best.cells, best.turns, best.seconds);
+    if (sim_robot.held)
+        printf("  speed run: held after %d cells, standing still %.2f s later\n", speed.cells, speed.seconds);
+    else if (speed.on)
+        printf("  speed run: %d cells in %.2f s, cell edges crossed up to %.0f mm off their midpoints\n",
+               speed.cells, speed.seconds, speed.worst_mm);
+    printf("  gyro: %lu samples clipped at full scale\n", (unsigned long)MPU_SaturatedSamples());
+
+    if (opt.profile) {
+        char line[80];
+        printf("  %-6s %8s %9s %9s %9s  (us)\n", "zone", "count", "min", "mean", "max");
+        for (int i = 0; i < PERF_ZONE_COUNT; i++) {
+            Perf_Format((PerfZone)i, line, sizeof(line));
+            printf("  %s\n", line);
+        }
+    }
+    return success ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+/*
+ * Converts the firmware's post-run telemetry dump to CSV.
+ *   tlm2csv [dump.bin] > run.csv       (stdin when no file is given)
+ *
+ * The serial capture may hold boot chatter and several runs: every dump found
+ * is decoded, numbered in the first column. Encoder counts are unwrapped from
+ * their 16 bits, fixed-point fields scaled back to mm and degrees.
+ */
+#include "telemetry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *const STATE_NAMES[] = { "straight", "diagonal", "pivot", "curve", "diag_turn" };
+
+static const char *state_name(uint8_t state) {
+    uint8_t type = state & ~TELEMETRY_BRAKED;
+    if (type == TELEMETRY_IDLE) return "idle";
+    if (type < sizeof(STATE_NAMES) / sizeof(STATE_NAMES[0])) return STATE_NAMES[type];
+    return "?";
+}
+
+static uint16_t fletcher16(const uint8_t *data, size_t len) {
+    uint16_t a = 0, b = 0;
+    while (len--) {
+        a = (uint16_t)((a + *data++) % 255);
+        b = (uint16_t)((b + a) % 255);
+    }
+    return (uint16_t)(b << 8 | a);
+}
+
+static uint8_t *slurp(FILE *in, size_t *size) {
+    size_t cap = 1 << 16, len = 0;
+    uint8_t *buf = malloc(cap);
+    size_t n;
+    while (buf && (n = fread(buf + len, 1, cap - len, in)) > 0) {
+        len += n;
+        if (len == cap) buf = realloc(buf, cap *= 2);
+    }
+    *size = len;
+    return buf;
+}
+
+static void print_records(int dump, const TelemetryRecord *r, int count) {
+    uint32_t t0 = count ? r->t_us : 0;
+    int32_t enc_l = 0, enc_r = 0;
+    for (int i = 0; i < count; i++, r++) {
+        // Ticks between records are far fewer than 32768: the 16-bit difference is the step
+        if (i == 0) {
+            enc_l = r->enc_left;
+            enc_r = r->enc_right;
+        } else {
+            enc_l += (int16_t)(r->enc_left - r[-1].enc_left);
+            enc_r += (int16_t)(r->enc_right - r[-1].enc_right);
+        }
+        bool straight = (r->state & ~TELEMETRY_BRAKED) == 0;
+
+        printf("%d,%.3f,%d,%d,%u,%u,%u,%s,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%d,%d,%d,%d,%d,%d\n",
+               dump, (r->t_us - t0) / 1000.0, enc_l, enc_r,
+               r->tof_left, r->tof_front, r->tof_right, state_name(r->state), (r->state & TELEMETRY_BRAKED) != 0,
+               r->left_filtered / 16.0, r->right_filtered / 16.0, r->yaw / 100.0,
+               straight ? r->error / 16.0 : 0.0, straight ? 0.0 : r->error / 100.0,
+               r->target_left, r->target_right, r->speed_left, r->speed_right, r->pwm_left, r->pwm_right);
+    }
+}
+
+int main(int argc, char **argv) {
+    FILE *in = stdin;
+    if (argc > 2 || (argc == 2 && argv[1][0] == '-' && argv[1][1])) {
+        fprintf(stderr, "usage: %s [dump.bin] > run.csv\n", argv[0]);
+        return 2;
+    }
+    if (argc == 2 && strcmp(argv[1], "-") != 0) {
+        in = fopen(argv[1], "rb");
+        if (!in) {
+            perror(argv[1]);
+            return 2;
+        }
+    }
+
+    size_t size;
+    uint8_t *buf = slurp(in, &size);
+    if (!buf) {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+
+    puts("dump,t_ms,enc_left,enc_right,tof_left,tof_front,tof_right,state,braked,"
+         "left_filtered_mm,right_filtered_mm,yaw_deg,center_error_mm,yaw_error_deg,"
+         "target_left,target_right,speed_left,speed_right,pwm_left,pwm_right");
+
+    int dumps = 0, bad = 0;
+    for (size_t pos = 0; pos + sizeof(TelemetryHeader) <= size; pos++) {
+        TelemetryHeader h;
+        memcpy(&h, buf + pos, sizeof(h));
+        if (h.magic != TELEMETRY_MAGIC) continue;
+
+        if (h.record_size != sizeof(TelemetryRecord)) {
+            fprintf(stderr, "dump at byte %zu: %u-byte records, this decoder reads %zu\n",
+                    pos, h.record_size, sizeof(TelemetryRecord));
+            bad++;
+            continue;
+        }
+        size_t body = (size_t)h.count * sizeof(TelemetryRecord);
+        size_t start = pos + sizeof(h);
+        if (start + body + 2 > size) {
+            fprintf(stderr, "dump at byte %zu: truncated\n", pos);
+            bad++;
+            break;
+        }
+
+        uint16_t sum;
+        memcpy(&sum, buf + start + body, sizeof(sum));
+        if (fletcher16(buf + start, body) != sum) {
+            fprintf(stderr, "dump at byte %zu: checksum mismatch, skipped\n", pos);
+            bad++;
+            continue;
+        }
+
+        TelemetryRecord *records = malloc(body ? body : 1);
+        memcpy(records, buf + start, body);
+        print_records(dumps++, records, h.count);
+        free(records);
+        pos = start + body + 1;
+    }
+
+    if (dumps == 0) fprintf(stderr, "no telemetry dump found\n");
+    free(buf);
+    return (dumps == 0 || bad) ? 1 : 0;
+}
@@ -0,0 +1,204 @@
+#include "sim.h"
+#include <math.h>
+#include <string.h>
+
+#define CELL     ((double)CELL_MM)
+#define HALF_WALL (SIM_WALL_MM / 2)
+
+MazeWalls sim_maze;
+
+/* Wall slabs and posts as axis-aligned boxes, for ray casting */
+typedef struct { double x0, y0, x1, y1; } Box;
+static Box boxes[2 * (W + 1) * (H + 1) + (W + 1) * (H + 1)];
+static int box_count;
+
+/* ===== Random numbers ===== */
+uint32_t sim_rand(uint32_t *state) {
+    uint32_t s = *state ? *state : 0x9E3779B9u;
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    return *state = s;
+}
+
+double sim_gauss(uint32_t *state) {
+    double u1 = (sim_rand(state) + 1.0) / 4294967297.0;
+    double u2 = (sim_rand(state) + 1.0) / 4294967297.0;
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+/* ===== Maze generation ===== */
+static const int DX[4] = { 0, 1, 0, -1 };
+static const int DY[4] = { 1, 0, -1, 0 };
+
+static bool inside(int x, int y) { return x >= 0 && x < W && y >= 0 && y < H; }
+
+// Cells reachable from the start, as row masks
+static void reachable(uint16_t seen[H]) {
+    uint16_t seed[H] = { 0 };
+    uint8_t dist[W][H];
+    seed[0] = 1;
+    Maze_Flood(&sim_maze, seed, false, dist);
+    for (int y = 0; y < H; y++) {
+        seen[y] = 0;
+        for (int x = 0; x < W; x++)
+            if (dist[x][y] != 255) seen[y] |= (uint16_t)(1u << x);
+    }
+}
+
+/*
+ * Depth-first perfect maze, then the classic rules: the centre 2x2 is one open
+ * room and the start cell only opens north. extra_openings knocks out random
+ * interior walls so there is more than one route.
+ */
+void world_generate(uint32_t seed, int extra_openings) {
+    static int stack[W * H];
+    bool visited[W][H] = { { false } };
+    uint32_t rng = seed * 2654435761u + 1;
+
+    Maze_Clear(&sim_maze);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            Maze_SetWall(&sim_maze, x, y, North, true);
+            Maze_SetWall(&sim_maze, x, y, East, true);
+        }
+    }
+
+    int top = 0;
+    stack[top++] = 0;
+    visited[0][0] = true;
+    while (top > 0) {
+        int c = stack[top - 1];
+        int x = c % W, y = c / W;
+        int options[4], n = 0;
+        for (int d = 0; d < 4; d++) {
+            int nx = x + DX[d], ny = y + DY[d];
+            if (inside(nx, ny) && !visited[nx][ny]) options[n++] = d;
+        }
+        if (n == 0) {
+            top--;
+            continue;
+        }
+        int d = options[sim_rand(&rng) % n];
+        Maze_SetWall(&sim_maze, x, y, (Direction)d, false);
+        visited[x + DX[d]][y + DY[d]] = true;
+        stack[top++] = (y + DY[d]) * W + x + DX[d];
+    }
+
+    for (int i = 0; i < extra_openings; i++) {
+        int x = (int)(sim_rand(&rng) % W), y = (int)(sim_rand(&rng) % H);
+        Direction d = (sim_rand(&rng) & 1) ? North : East;
+        if (inside(x + DX[d], y + DY[d])) Maze_SetWall(&sim_maze, x, y, d, false);
+    }
+
+    int cx = W / 2 - 1, cy = H / 2 - 1;
+    Maze_SetWall(&sim_maze, cx, cy, East, false);
+    Maze_SetWall(&sim_maze, cx, cy, North, false);
+    Maze_SetWall(&sim_maze, cx + 1, cy, North, false);
+    Maze_SetWall(&sim_maze, cx, cy + 1, East, false);
+
+    Maze_SetWall(&sim_maze, 0, 0, East, true);
+    Maze_SetWall(&sim_maze, 0, 0, North, false);
+
+    // Closing the start cell's east side can cut a region off; reconnect it
+    for (;;) {
+        uint16_t seen[H];
+        reachable(seen);
+        int x, y = 0;
+        bool joined = false;
+        for (y = 0; y < H && !joined; y++) {
+            for (x = 0; x < W && !joined; x++) {
+                if (!(seen[y] >> x & 1)) continue;
+                for (int d = 0; d < 4 && !joined; d++) {
+                    int nx = x + DX[d], ny = y + DY[d];
+                    if (!inside(nx, ny) || (seen[ny] >> nx & 1)) continue;
+                    if (x == 0 && y == 0) continue;
+                    Maze_SetWall(&sim_maze, x, y, (Direction)d, false);
+                    joined = true;
+                }
+            }
+        }
+        if (!joined) break;
+    }
+
+    world_build();
+}
+
+/* ===== Geometry ===== */
+static bool hwall(int x, int j) { return j == 0 || j == H || Maze_HasWall(&sim_maze, x, j - 1, North); }
+static bool vwall(int i, int y) { return i == 0 || i == W || Maze_HasWall(&sim_maze, i - 1, y, East); }
+
+void world_build(void) {
+    box_count = 0;
+    for (int j = 0; j <= H; j++) {
+        for (int i = 0; i <= W; i++) {
+            boxes[box_count++] = (Box){ i * CELL - HALF_WALL, j * CELL - HALF_WALL, i * CELL + HALF_WALL, j * CELL + HALF_WALL };
+            if (i < W && hwall(i, j))
+                boxes[box_count++] = (Box){ i * CELL, j * CELL - HALF_WALL, (i + 1) * CELL, j * CELL + HALF_WALL };
+            if (j < H && vwall(i, j))
+                boxes[box_count++] = (Box){ i * CELL - HALF_WALL, j * CELL, i * CELL + HALF_WALL, (j + 1) * CELL };
+        }
+    }
+}
+
+// Entry distance of the ray into the box, or INFINITY
+static double ray_box(double x, double y, double dx, double dy, const Box *b) {
+    double t0 = 0, t1 = INFINITY;
+    if (fabs(dx) < 1e-12) {
+        if (x < b->x0 || x > b->x1) return INFINITY;
+    } else {
+        double a = (b->x0 - x) / dx, c = (b->x1 - x) / dx;
+        t0 = fmax(t0, fmin(a, c));
+        t1 = fmin(t1, fmax(a, c));
+    }
+    if (fabs(dy) < 1e-12) {
+        if (y < b->y0 || y > b->y1) return INFINITY;
+    } else {
+        double a = (b->y0 - y) / dy, c = (b->y1 - y) / dy;
+        t0 = fmax(t0, fmin(a, c));
+        t1 = fmin(t1, fmax(a, c));
+    }
+    return (t0 <= t1) ? t0 : INFINITY;
+}
+
+double world_raycast(double x, double y, double angle, double max_mm) {
+    double dx = cos(angle), dy = sin(angle);
+    double best = max_mm;
+    for (int i = 0; i < box_count; i++) {
+        const Box *b = &boxes[i];
+        // Cheap reject: box entirely out of reach
+        if (b->x1 < x - best || b->x0 > x + best || b->y1 < y - best || b->y0 > y + best) continue;
+        double t = ray_box(x, y, dx, dy, b);
+        if (t < best) best = t;
+    }
+    return best;
+}
+
+static bool circle_box(double x, double y, double r, double x0, double y0, double x1, double y1) {
+    double px = fmin(fmax(x, x0), x1), py = fmin(fmax(y, y0), y1);
+    return (px - x) * (px - x) + (py - y) * (py - y) < r * r;
+}
+
+/* Only the gridlines around the robot's cell can touch it */
+bool world_collides(double x, double y, double radius) {
+    int cx = (int)floor(x / CELL), cy = (int)floor(y / CELL);
+    for (int j = cy - 1; j <= cy + 2; j++) {
+        for (int i = cx - 1; i <= cx + 2; i++) {
+            if (i < 0 || i > W || j < 0 || j > H) continue;
+            if (circle_box(x, y, radius, i * CELL - HALF_WALL, j * CELL - HALF_WALL, i * CELL + HALF_WALL, j * CELL + HALF_WALL))
+                return true;
+            if (i < W && hwall(i, j) &&
+                circle_box(x, y, radius, i * CELL, j * CELL - HALF_WALL, (i + 1) * CELL, j * CELL + HALF_WALL))
+                return true;
+            if (j < H && vwall(i, j) &&
+                circle_box(x, y, radius, i * CELL - HALF_WALL, j * CELL, i * CELL + HALF_WALL, (j + 1) * CELL))
+                return true;
+        }
+    }
+    return false;
+}
+
+void world_load(const MazeWalls *m) {
+    sim_maze = *m;
+    world_build();
+}